@@ -0,0 +1,135 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    batch.c
+   @author  Leslie Satenstein
+   @brief   Forked job pool (see batch.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "batch.h"
+#include <getopt.h>
+#include <limits.h>
+#include <sys/wait.h>
+
+#define BATCH_MAXARGS 64
+
+/*--------------------------------------------------------------------------*/
+/* split line in place into argv, argv[0] being the program name           */
+static int batch_split(char *line, char *pgm, char **argv)
+{
+    int   argc=0;
+    char *tok;
+
+    argv[argc++]=pgm;
+    for(tok=strtok(line," \t\r\n"); tok!=NULL && argc<BATCH_MAXARGS-1; tok=strtok(NULL," \t\r\n"))
+        argv[argc++]=tok;
+    argv[argc]=NULL;
+    return argc;
+}
+
+/*--------------------------------------------------------------------------*/
+/* wait for one child, report it if it failed. Returns 1 for a failure    */
+static int batch_reap(pid_t *pids, int *lines, int jobs)
+{
+    pid_t pid;
+    int   status;
+    int   i;
+
+    pid=wait(&status);
+    if(pid<0)
+        return 0;
+    for(i=0;i<jobs;i++)
+        if(pids[i]==pid)
+            break;
+    if(i<jobs)
+        pids[i]=0;
+    if(WIFEXITED(status) && WEXITSTATUS(status)==0)
+        return 0;
+    fprintf(stderr,"batch: job on line %d failed with status %d\n",
+            i<jobs ? lines[i] : 0,
+            WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
+    return 1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief batch_run   Run job once per line of listfile, jobs at a time
+ */
+/*--------------------------------------------------------------------------*/
+int batch_run(const char *pgm, const char *listfile, int jobs, batch_job job)
+{
+    FILE  *list;
+    char   line[PATH_MAX*4];
+    char  *argv[BATCH_MAXARGS];
+    char   name[PATH_MAX];
+    pid_t *pids;
+    int   *lines;
+    int    running=0;
+    int    failed=0;
+    int    lineno=0;
+    int    argc;
+    int    i;
+    pid_t  pid;
+
+    if(jobs<=0)
+        jobs=sysconf(_SC_NPROCESSORS_ONLN);
+    if(jobs<=0)
+        jobs=1;
+    list= strcmp(listfile,"-") ? fopen(listfile,"rb") : stdin;
+    if(list==NULL)
+    {
+        fprintf(stderr,"Can't open batch list \"%s\"\n",listfile);
+        return -1;
+    }
+    pids=calloc(jobs,sizeof(pid_t));
+    lines=calloc(jobs,sizeof(int));
+    if(pids==NULL || lines==NULL)
+    {
+        fprintf(stderr,"%s: Out of memory\n",__FUNCTION__);
+        exit(-1);
+    }
+    snprintf(name,sizeof(name),"%s",pgm);
+
+    while(fgets(line,sizeof(line),list)!=NULL)
+    {
+        lineno++;
+        argc=batch_split(line,name,argv);
+        if(argc<2 || *argv[1]=='#')
+            continue;
+        if(running==jobs)
+        {
+            failed+=batch_reap(pids,lines,jobs);
+            running--;
+        }
+        for(i=0;i<jobs && pids[i]!=0;i++)
+            ;
+        fflush(NULL);                   /* do not duplicate buffered output */
+        pid=fork();
+        if(pid<0)
+        {
+            fprintf(stderr,"batch: fork failed for line %d: %s\n",lineno,strerror(errno));
+            failed++;
+            continue;
+        }
+        if(pid==0)
+        {
+            if(list!=stdin)
+                fclose(list);
+            optind=0;                   /* full getopt() reset for the job */
+            exit(job(argc,argv));
+        }
+        pids[i]=pid;
+        lines[i]=lineno;
+        running++;
+    }
+    while(running-->0)
+        failed+=batch_reap(pids,lines,jobs);
+    if(list!=stdin)
+        fclose(list);
+    free(pids);
+    free(lines);
+    return failed;
+}
@@ -0,0 +1,40 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    batch.h
+   @author  Leslie Satenstein
+   @brief   Run many jobs of the same program in parallel.
+
+   Each line of a batch list holds the command line options of one job,
+   for example
+       -d img/web01.raw -i img/web01.fstab -o out/web01.xref
+   Blank lines and lines starting with '#' are skipped. Every job runs
+   in its own forked process, at most "jobs" at a time, so the global
+   state of the programs (dictionary, file names) needs no locking.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "dictionary.h"
+
+/** a job is a main() like function: options in, exit status out */
+typedef int (*batch_job)(int argc, char **argv);
+
+/**
+ * @brief batch_run   Run job once per line of listfile
+ * @param pgm         program name, passed as argv[0] of every job
+ * @param listfile    the batch list, "-" for standard input
+ * @param jobs        number of jobs to run at the same time, 0 for the
+ *                    number of online processors
+ * @param job         function run in the child process
+ * @return            number of jobs that failed, -1 if listfile can not
+ *                    be read
+ */
+int batch_run(const char *pgm, const char *listfile, int jobs, batch_job job);
+
+#endif
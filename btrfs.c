@@ -0,0 +1,200 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    btrfs.c
+   @author  Leslie Satenstein
+   @brief   btrfs member grouping and subvol= annotation (see btrfs.h)
+
+   Two contiguous arrays:
+       fsids[]    one row per filesystem: fsid, first member, member count
+       members[]  all member devices, sorted by (filesystem, devid) in
+                  btrfs_finish() so each filesystem's members are adjacent
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "btrfs.h"
+#include "fsprobe.h"
+#include "sysroot.h"
+#include <fcntl.h>
+#include <limits.h>
+
+struct btrfs_fs
+{
+    char fsid[40];
+    int  first;                 /* index of the first member, after finish */
+    int  count;
+};
+
+static struct btrfs_fs     *fsids;
+static int                  nfs,sizefs;
+static struct btrfs_member *members;
+static int                  nmem,sizemem;
+
+/*--------------------------------------------------------------------------*/
+static int btrfs_fs_index(const char *fsid)
+{
+    void *p;
+    int i;
+
+    for(i=0;i<nfs;i++)
+        if(!strcmp(fsids[i].fsid,fsid))
+            return i;
+    if(nfs==sizefs)
+    {
+        sizefs= sizefs ? 2*sizefs : 8;
+        p=realloc(fsids,sizefs*sizeof(struct btrfs_fs));
+        if(p==NULL)
+            return -1;
+        fsids=p;
+    }
+    memset(&fsids[nfs],0,sizeof(struct btrfs_fs));
+    snprintf(fsids[nfs].fsid,sizeof(fsids[nfs].fsid),"%s",fsid);
+    return nfs++;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief btrfs_member_add  Record dev as a member of fsid
+ */
+/*--------------------------------------------------------------------------*/
+int btrfs_member_add(const char *fsid, const char *dev)
+{
+    struct fsprobe fp;
+    char path[PATH_MAX];
+    void *p;
+    int fd;
+    int i;
+
+    memset(&fp,0,sizeof(fp));
+    snprintf(path,sizeof(path),"/dev/%s",dev);
+    fd=sysroot_open(path,O_RDONLY);
+    if(fd>=0)
+    {
+        if(fsprobe_read(fd,0,0,&fp)<=0 || strcmp(fp.type,"btrfs"))
+            memset(&fp,0,sizeof(fp));
+        close(fd);
+    }
+    if(*fp.uuid=='\0')                  /* not readable, trust the caller */
+        snprintf(fp.uuid,sizeof(fp.uuid),"%s",fsid);
+
+    for(i=0;i<nmem;i++)
+        if(!strcmp(members[i].dev,dev))
+            return 0;                   /* listed twice */
+    if(nmem==sizemem)
+    {
+        sizemem= sizemem ? 2*sizemem : 16;
+        p=realloc(members,sizemem*sizeof(struct btrfs_member));
+        if(p==NULL)
+            return -1;
+        members=p;
+    }
+    i=btrfs_fs_index(fp.uuid);
+    if(i<0)
+        return -1;
+    members[nmem].fs=i;
+    members[nmem].devid=fp.devid;
+    snprintf(members[nmem].dev,sizeof(members[nmem].dev),"%s",dev);
+    nmem++;
+    debug("btrfs %s member %s devid %llu of %llu\n",fp.uuid,dev,
+          (unsigned long long)fp.devid,(unsigned long long)fp.ndevices);
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+static int member_cmp(const void *a, const void *b)
+{
+    const struct btrfs_member *x=a;
+    const struct btrfs_member *y=b;
+
+    if(x->fs!=y->fs)
+        return x->fs-y->fs;
+    if(x->devid!=y->devid)
+        return x->devid<y->devid ? -1 : 1;
+    return strcmp(x->dev,y->dev);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief btrfs_finish  Make each filesystem's members contiguous
+ */
+/*--------------------------------------------------------------------------*/
+void btrfs_finish(dictionary *d)
+{
+    int i;
+
+    if(nmem==0)
+        return;
+    qsort(members,nmem,sizeof(struct btrfs_member),member_cmp);
+    for(i=nmem-1;i>=0;i--)
+    {
+        fsids[members[i].fs].first=i;
+        fsids[members[i].fs].count++;
+    }
+    for(i=0;i<nfs;i++)
+        if(fsids[i].count)
+            dictionary_set(d,fsids[i].fsid,members[fsids[i].first].dev);
+}
+
+/*-------------------------------------------------------------------------*/
+const struct btrfs_member *btrfs_members(const char *dev, int *count)
+{
+    struct btrfs_fs *fs;
+    int i;
+
+    for(i=0;i<nmem;i++)
+    {
+        if(strcmp(members[i].dev,dev))
+            continue;
+        fs=&fsids[members[i].fs];
+        *count=fs->count;
+        return &members[fs->first];
+    }
+    *count=0;
+    return NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief btrfs_annotate  "/dev/sdb1 +/dev/sdc1 subvol=@home"
+ */
+/*--------------------------------------------------------------------------*/
+int btrfs_annotate(const char *dev, const char *opts, const char *prefix, char *out, size_t size)
+{
+    const struct btrfs_member *m;
+    const char *cp;
+    size_t len;
+    size_t j;
+    int count;
+    int i;
+
+    m=btrfs_members(dev,&count);
+    if(m==NULL)
+        return 0;
+    j=snprintf(out,size,"%s%s",prefix,m[0].dev);
+    for(i=1;i<count && j<size;i++)
+        j+=snprintf(out+j,size-j," +%s%s",prefix,m[i].dev);
+
+    /* subvol=/@home or subvolid=257 anywhere in the options */
+    for(cp=opts; cp!=NULL && *cp!='\0' && j<size; cp=strchr(cp,','))
+    {
+        if(*cp==',')
+            cp++;
+        if(memcmp(cp,"subvol=",7) && memcmp(cp,"subvolid=",9))
+            continue;
+        len=strcspn(cp,",");
+        j+=snprintf(out+j,size-j," %.*s",(int)len,cp);
+    }
+    return 1;
+}
+
+/*-------------------------------------------------------------------------*/
+void btrfs_free(void)
+{
+    free(members);
+    free(fsids);
+    members=NULL;
+    fsids=NULL;
+    nmem=sizemem=nfs=sizefs=0;
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    btrfs.h
+   @author  Leslie Satenstein
+   @brief   btrfs multi-device and subvolume awareness.
+
+   One btrfs filesystem UUID (the fsid) spans all of its member devices,
+   and fstab lines for the same filesystem differ only by their subvol=
+   or subvolid= option. lsblk lists every member with the same UUID, and
+   the dictionary used to keep whichever member came last.
+
+   Discovery calls btrfs_member_add() for every btrfs device. The member's
+   superblock is read to obtain its fsid and dev_item devid. btrfs_finish()
+   then sorts the members by filesystem and devid so the members of one
+   filesystem sit next to each other in one array, and binds the UUID key
+   to the lowest devid. Annotation needs no allocation:
+       #/dev/sdb1 +/dev/sdc1 +/dev/sdd1 subvol=@home
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _BTRFS_H_
+#define _BTRFS_H_
+
+#include "dictionary.h"
+
+/** one member device */
+struct btrfs_member
+{
+    int       fs;               /** index into the filesystem array        */
+    uint64_t  devid;            /** dev_item devid, 0 if unreadable        */
+    char      dev[32];          /** device name, sdb1                      */
+};
+
+/**
+ * @brief btrfs_member_add  Record dev as a member of the btrfs filesystem
+ *                          fsid. The superblock of /dev/dev is read for the
+ *                          fsid and devid; fsid is used if it can not be read.
+ * @return                  0 if Ok, -1 if out of memory
+ */
+int btrfs_member_add(const char *fsid, const char *dev);
+
+/**
+ * @brief btrfs_finish  Group the members of each filesystem, ordered by
+ *                      devid, and set key fsid to its first member
+ * @param d             the dictionary
+ */
+void btrfs_finish(dictionary *d);
+
+/**
+ * @brief btrfs_members  Members of the filesystem that holds dev
+ * @param dev            any member device name
+ * @param count          number of members returned
+ * @return               pointer to the first member, NULL if dev is not a
+ *                       known btrfs member
+ */
+const struct btrfs_member *btrfs_members(const char *dev, int *count);
+
+/**
+ * @brief btrfs_annotate  Annotation for a btrfs fstab line
+ * @param dev             the device the fstab spec resolved to
+ * @param opts            the options column, subvol= and subvolid= are shown
+ * @param prefix          printed in front of each device name ("/dev/")
+ * @param out             result, "/dev/sdb1 +/dev/sdc1 subvol=@home"
+ * @param size            size of out
+ * @return                1 if dev is a btrfs member, 0 otherwise
+ */
+int btrfs_annotate(const char *dev, const char *opts, const char *prefix, char *out, size_t size);
+
+/**
+ * @brief btrfs_free  Release the member arrays
+ */
+void btrfs_free(void);
+
+#endif
@@ -0,0 +1,826 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    capture.c
+   @author  Leslie Satenstein
+   @brief   Device environment capture and replay (see capture.h)
+
+   A captured path is walked one component at a time. Each symbolic link
+   met on the way is recorded and its target spliced into the rest of the
+   path, so /sys/class/block/sda1/../queue/rotational records the sda1
+   link, and the file at its resolved place under /sys/devices. A replay
+   walks a path the same way, with a binary search of the index for each
+   component.
+*/
+/*--------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE             /* O_PATH */
+#include "capture.h"
+#include "sysroot.h"
+#include "fsspec.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CAP_MAGIC    "FSXCAP2\n"
+#define CAP_FILEMAX  (1<<20)        /* largest regular file kept */
+#define CAP_HEAD     (65536+4096)   /* MBR, GPT, superblocks up to btrfs */
+#define CAP_TAIL     (256*1024)     /* backup GPT */
+#define CAP_LINKMAX  40
+
+struct caphead
+{
+    char     magic[8];
+    uint32_t count;
+    uint32_t pad;
+};
+
+struct capidx
+{
+    uint64_t path;              /* offset of the path in the file */
+    uint64_t data;              /* offset of the data in the file */
+    uint64_t len;               /* length of the data */
+    uint64_t size;              /* size of a block device */
+    uint64_t dev;               /* st_dev */
+    uint64_t rdev;              /* st_rdev */
+    uint32_t pathlen;
+    uint32_t type;              /* CAP_xxx */
+    uint32_t mode;              /* st_mode */
+    uint32_t pad;
+};
+
+/* a block device range, followed by len bytes */
+struct caprange
+{
+    uint64_t off;
+    uint64_t len;
+};
+
+struct capent
+{
+    char    *path;
+    int      type;
+    char    *data;
+    size_t   len;
+    uint64_t size;
+    uint64_t dev,rdev;
+    uint32_t mode;
+};
+
+static struct capent *ents;
+static int            nent,sizeent;
+
+/* the archive being replayed */
+static const unsigned char *rmap;
+static size_t               rsize;
+static const struct capidx *ridx;
+static long                 rcount;
+static int                 *rfd;       /* memfd of a block entry, -1 if none */
+
+/*--------------------------------------------------------------------------*/
+/* record one path, data is taken over                                     */
+static int cap_add(const char *path, int type, char *data, size_t len, uint64_t size,
+                   const struct stat *st)
+{
+    void *p;
+
+    if(nent==sizeent)
+    {
+        sizeent= sizeent ? 2*sizeent : 256;
+        p=realloc(ents,sizeent*sizeof(struct capent));
+        if(p==NULL)
+            exit(-1);
+        ents=p;
+    }
+    ents[nent].path=strdup(path);
+    if(ents[nent].path==NULL)
+        exit(-1);
+    ents[nent].type=type;
+    ents[nent].data=data;
+    ents[nent].len=len;
+    ents[nent].size=size;
+    ents[nent].dev=st->st_dev;
+    ents[nent].rdev=st->st_rdev;
+    ents[nent].mode=st->st_mode;
+    nent++;
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/* a regular file, read to its end: sysfs files all claim 4096 bytes       */
+static void cap_file(const char *path, const struct stat *st)
+{
+    char   *buf;
+    size_t  len=0;
+    ssize_t got=0;
+    int fd;
+
+    fd=sysroot_open(path,O_RDONLY|O_NONBLOCK);
+    if(fd<0)
+        return;
+    buf=malloc(CAP_FILEMAX);
+    if(buf==NULL)
+        exit(-1);
+    while(len<CAP_FILEMAX && (got=read(fd,buf+len,CAP_FILEMAX-len))>0)
+        len+=got;
+    close(fd);
+    if(got<0 && len==0)         /* unreadable attribute, leave it out */
+    {
+        free(buf);
+        return;
+    }
+    cap_add(path,CAP_FILE,realloc(buf,len ? len : 1),len,0,st);
+}
+
+/*--------------------------------------------------------------------------*/
+/* the head and the tail of a block device                                 */
+static void cap_block(const char *path, const struct stat *st)
+{
+    struct caprange r[2];
+    char   *buf;
+    off_t   size;
+    size_t  len=0;
+    int     n,i;
+    int     fd;
+
+    fd=sysroot_open(path,O_RDONLY|O_NONBLOCK);
+    if(fd<0)
+        return;
+    size=lseek(fd,0,SEEK_END);
+    if(size<=0)
+    {
+        close(fd);
+        return;
+    }
+    r[0].off=0;
+    r[0].len= size<CAP_HEAD ? size : CAP_HEAD;
+    n=1;
+    if(size>CAP_HEAD)
+    {
+        r[1].off= size-CAP_TAIL>CAP_HEAD ? size-CAP_TAIL : CAP_HEAD;
+        r[1].len=size-r[1].off;
+        n=2;
+    }
+    buf=malloc(2*sizeof(struct caprange)+CAP_HEAD+CAP_TAIL);
+    if(buf==NULL)
+        exit(-1);
+    for(i=0;i<n;i++)
+    {
+        if(pread(fd,buf+len+sizeof(struct caprange),r[i].len,r[i].off)!=(ssize_t)r[i].len)
+            break;
+        memcpy(buf+len,&r[i],sizeof(struct caprange));
+        len+=sizeof(struct caprange)+r[i].len;
+    }
+    close(fd);
+    cap_add(path,CAP_BLOCK,buf,len,size,st);
+}
+
+/*--------------------------------------------------------------------------*/
+/* record path and every link met while resolving it                       */
+static int cap_path(const char *path, int depth)
+{
+    char cur[PATH_MAX];
+    char next[PATH_MAX];
+    char rest[2*PATH_MAX];
+    char target[PATH_MAX];
+    char comp[NAME_MAX+1];
+    struct stat st;
+    const char *p;
+    ssize_t n;
+    size_t len;
+    int dfd;
+
+    if(depth>CAP_LINKMAX)
+        return -1;
+    *cur='\0';
+    memset(&st,0,sizeof(st));
+    st.st_mode=S_IFDIR;
+    for(p=path; ; )
+    {
+        while(*p=='/')
+            p++;
+        if(*p=='\0')
+            break;
+        len=strcspn(p,"/");
+        if(len>NAME_MAX)
+            return -1;
+        memcpy(comp,p,len);
+        comp[len]='\0';
+        p+=len;
+        if(!strcmp(comp,"."))
+            continue;
+        if(!strcmp(comp,".."))
+        {
+            if(strrchr(cur,'/'))
+                *strrchr(cur,'/')='\0';
+            continue;
+        }
+        dfd=sysroot_open(*cur ? cur : "/",O_PATH|O_DIRECTORY);
+        if(dfd<0)
+            return -1;
+        if(fstatat(dfd,comp,&st,AT_SYMLINK_NOFOLLOW)
+           || snprintf(next,sizeof(next),"%s/%s",cur,comp)>=(int)sizeof(next))
+        {
+            close(dfd);
+            return -1;
+        }
+        if(S_ISLNK(st.st_mode))
+        {
+            n=readlinkat(dfd,comp,target,sizeof(target)-1);
+            close(dfd);
+            if(n<=0)
+                return -1;
+            target[n]='\0';
+            cap_add(next,CAP_LINK,strdup(target),n,0,&st);
+            if(*target=='/')
+                snprintf(rest,sizeof(rest),"%s%s",target,p);
+            else
+                snprintf(rest,sizeof(rest),"%s/%s%s",cur,target,p);
+            return cap_path(rest,depth+1);
+        }
+        close(dfd);
+        if(*p!='\0' && !S_ISDIR(st.st_mode))
+            return -1;
+        strcpy(cur,next);
+    }
+    if(*cur=='\0')
+        return 0;
+    if(S_ISDIR(st.st_mode))
+        cap_add(cur,CAP_DIR,NULL,0,0,&st);
+    else if(S_ISREG(st.st_mode) && st.st_size<=CAP_FILEMAX)
+        cap_file(cur,&st);
+    else if(S_ISBLK(st.st_mode) || S_ISREG(st.st_mode))
+        cap_block(cur,&st);     /* a device, or a disk image standing for one */
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/* a directory and each of its entries, not recursive                      */
+static void cap_dir(const char *path)
+{
+    char name[PATH_MAX];
+    struct dirent *de;
+    sysdir *dir;
+
+    if(cap_path(path,0))
+        return;
+    dir=sysroot_opendir(path);
+    if(dir==NULL)
+        return;
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(!strcmp(de->d_name,".") || !strcmp(de->d_name,".."))
+            continue;
+        snprintf(name,sizeof(name),"%s/%s",path,de->d_name);
+        cap_path(name,0);
+    }
+    sysroot_closedir(dir);
+}
+
+/* the path sources of the fstab: /dev/loop0, /swapfile, disk images      */
+static void cap_sources(const char *fstab)
+{
+    char line[PATH_MAX];
+    char spec[PATH_MAX];
+    FILE *f;
+
+    f=sysroot_fopen(fstab);
+    if(f==NULL)
+        return;
+    while(fgets(line,sizeof(line),f)!=NULL)
+    {
+        if(sscanf(line,"%4095s",spec)!=1 || *spec!='/')
+            continue;
+        fsspec_decode(spec);            /* as filedev_fill() stats it */
+        cap_path(spec,0);
+    }
+    fclose(f);
+}
+
+/*--------------------------------------------------------------------------*/
+/* component order: '/' sorts before every other byte, so the entries      */
+/* below a directory follow it without a gap                               */
+static int path_cmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+    size_t i;
+
+    for(i=0;i<alen && i<blen;i++)
+        if(a[i]!=b[i])
+            return (a[i]=='/' ? 0 : (unsigned char)a[i])-(b[i]=='/' ? 0 : (unsigned char)b[i]);
+    return alen<blen ? -1 : alen>blen;
+}
+
+static int cap_cmp(const void *a, const void *b)
+{
+    const char *pa=((const struct capent *)a)->path;
+    const char *pb=((const struct capent *)b)->path;
+
+    return path_cmp(pa,strlen(pa),pb,strlen(pb));
+}
+
+/* the attributes read below /sys/class/block/<dev> */
+static const char * const devattrs[]=
+{
+    "dev", "size", "partition", "ro", "dm/uuid", "dm/name", "device/wwid", "wwid",
+    "loop/backing_file", "loop/offset", "queue/rotational", "../queue/rotational",
+    "device/model", "../device/model", "device/serial", "serial", "device/vpd_pg80",
+    "../device/serial", "../serial", "../device/vpd_pg80", NULL
+};
+
+static const char * const bydirs[]=
+{
+    "by-uuid", "by-label", "by-partuuid", "by-partlabel", "by-id", "by-path", NULL
+};
+
+/* the other mount configuration of -a, see inputs.c */
+static const char * const inputdirs[]=
+{
+    "/etc/fstab.d", "/etc/systemd/system", "/run/systemd/system", "/run/systemd/generator", NULL
+};
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief capture_write  Walk what discovery reads, then write the archive
+ */
+/*--------------------------------------------------------------------------*/
+int capture_write(const char *file, const char *fstab)
+{
+    struct caphead head;
+    struct capidx  idx;
+    struct dirent *de;
+    const char * const *cpp;
+    char   path[PATH_MAX];
+    char   dev[32];
+    uint64_t off;
+    FILE  *f;
+    sysdir *dir;
+    int    i,j;
+
+    cap_path(fstab,0);
+    cap_sources(fstab);
+    cap_path("/proc/partitions",0);
+    cap_path("/etc/crypttab",0);
+    for(cpp=inputdirs;*cpp;cpp++)
+        cap_dir(*cpp);
+    for(cpp=bydirs;*cpp;cpp++)
+    {
+        snprintf(path,sizeof(path),"/dev/disk/%s",*cpp);
+        cap_dir(path);
+    }
+    cap_dir("/sys/block");
+    cap_dir("/sys/class/block");
+    dir=sysroot_opendir("/sys/class/block");
+    while(dir!=NULL && (de=sysroot_readdir(dir))!=NULL)
+    {
+        if(*de->d_name=='.')
+            continue;
+        for(cpp=devattrs;*cpp;cpp++)
+        {
+            snprintf(path,sizeof(path),"/sys/class/block/%s/%s",de->d_name,*cpp);
+            cap_path(path,0);
+        }
+        snprintf(path,sizeof(path),"/sys/class/block/%s/slaves",de->d_name);
+        cap_dir(path);
+        snprintf(path,sizeof(path),"/sys/class/block/%s/holders",de->d_name);
+        cap_dir(path);                  /* kpartx maps, see parttable_devname() */
+        snprintf(path,sizeof(path),"/sys/class/block/%s/dev",de->d_name);
+        f=sysroot_fopen(path);
+        if(f!=NULL)
+        {
+            if(fscanf(f,"%31s",dev)==1)
+            {
+                snprintf(path,sizeof(path),"/run/udev/data/b%s",dev);
+                cap_path(path,0);
+            }
+            fclose(f);
+        }
+        snprintf(path,sizeof(path),"/dev/%s",de->d_name);
+        cap_path(path,0);
+    }
+    if(dir!=NULL)
+        sysroot_closedir(dir);
+
+    /* sorted and unique: a link met by many paths is kept once */
+    qsort(ents,nent,sizeof(struct capent),cap_cmp);
+    for(i=j=0;i<nent;i++)
+    {
+        if(j && !strcmp(ents[j-1].path,ents[i].path))
+        {
+            free(ents[i].path);
+            free(ents[i].data);
+            continue;
+        }
+        ents[j++]=ents[i];
+    }
+    nent=j;
+
+    f=fopen(file,"wb");
+    if(f==NULL)
+        return -1;
+    memset(&head,0,sizeof(head));
+    memcpy(head.magic,CAP_MAGIC,8);
+    head.count=nent;
+    fwrite(&head,sizeof(head),1,f);
+    off=sizeof(head)+(uint64_t)nent*sizeof(struct capidx);
+    for(i=0;i<nent;i++)
+    {
+        memset(&idx,0,sizeof(idx));
+        idx.pathlen=strlen(ents[i].path);
+        idx.path=off;
+        idx.data=off+idx.pathlen;
+        idx.len=ents[i].len;
+        idx.size=ents[i].size;
+        idx.dev=ents[i].dev;
+        idx.rdev=ents[i].rdev;
+        idx.mode=ents[i].mode;
+        idx.type=ents[i].type;
+        off=idx.data+idx.len;
+        fwrite(&idx,sizeof(idx),1,f);
+    }
+    for(i=0;i<nent;i++)
+    {
+        fwrite(ents[i].path,1,strlen(ents[i].path),f);
+        if(ents[i].len)
+            fwrite(ents[i].data,1,ents[i].len,f);
+        free(ents[i].path);
+        free(ents[i].data);
+    }
+    free(ents);
+    ents=NULL;
+    j=nent;
+    nent=sizeent=0;
+    if(fclose(f))
+        return -1;
+    return j;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* an archive path is /a/b/c: no empty, . or .. component, none too long,  */
+/* no NUL byte                                                             */
+static int replay_pathok(const char *path, size_t pathlen)
+{
+    const char *p;
+    size_t len;
+
+    if(pathlen==0 || pathlen>=PATH_MAX || *path!='/' || memchr(path,'\0',pathlen))
+        return 0;
+    for(p=path+1; ; p+=len+1)
+    {
+        len=0;
+        while(p+len<path+pathlen && p[len]!='/')
+            len++;
+        if(len==0 || len>NAME_MAX || (len==1 && *p=='.') || (len==2 && p[0]=='.' && p[1]=='.'))
+            return 0;
+        if(p+len==path+pathlen)
+            return 1;
+    }
+}
+
+static const char *rpath(long i)
+{
+    return (const char *)rmap+ridx[i].path;
+}
+
+/* first entry not below path in component order                           */
+static long rlower(const char *path, size_t len)
+{
+    long lo=0,hi=rcount,mid;
+
+    while(lo<hi)
+    {
+        mid=(lo+hi)/2;
+        if(path_cmp(rpath(mid),ridx[mid].pathlen,path,len)<0)
+            lo=mid+1;
+        else
+            hi=mid;
+    }
+    return lo;
+}
+
+/* the entry of path, -1 if none                                           */
+static long rfind(const char *path, size_t len)
+{
+    long i=rlower(path,len);
+
+    return i<rcount && ridx[i].pathlen==len && !memcmp(rpath(i),path,len) ? i : -1;
+}
+
+/* whether some entry lies below path: a directory the capture walked      */
+/* through without recording it                                            */
+static int rbelow(const char *path, size_t len)
+{
+    char pre[PATH_MAX+1];
+    long i;
+
+    if(len+1>=sizeof(pre))
+        return 0;
+    memcpy(pre,path,len);
+    pre[len]='/';
+    i=rlower(pre,len+1);
+    return i<rcount && ridx[i].pathlen>len+1 && !memcmp(rpath(i),pre,len+1);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief replay_open  Map the archive and check every index entry
+ */
+/*--------------------------------------------------------------------------*/
+int replay_open(const char *file)
+{
+    const struct caphead *head;
+    const struct capidx  *x;
+    unsigned char *map;
+    struct stat st;
+    long   i;
+    int    fd;
+
+    replay_close();
+    fd=open(file,O_RDONLY|O_CLOEXEC);
+    if(fd<0)
+        return -1;
+    if(fstat(fd,&st) || st.st_size<(off_t)sizeof(struct caphead))
+    {
+        close(fd);
+        return -1;
+    }
+    map=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(map==MAP_FAILED)
+        return -1;
+    head=(const struct caphead *)map;
+    x=(const struct capidx *)(map+sizeof(struct caphead));
+    if(memcmp(head->magic,CAP_MAGIC,8)
+       || head->count>(st.st_size-sizeof(struct caphead))/sizeof(struct capidx))
+    {
+        fprintf(stderr,"%s is not a capture file\n",file);
+        munmap(map,st.st_size);
+        return -1;
+    }
+    /* lookups trust the index from here on: in bounds, sane, sorted */
+    for(i=0;i<(long)head->count;i++)
+        if(x[i].path>(uint64_t)st.st_size || x[i].pathlen>st.st_size-x[i].path
+           || x[i].data>(uint64_t)st.st_size || x[i].len>st.st_size-x[i].data
+           || !replay_pathok((const char *)map+x[i].path,x[i].pathlen)
+           || (i>0 && path_cmp((const char *)map+x[i-1].path,x[i-1].pathlen,
+                               (const char *)map+x[i].path,x[i].pathlen)>=0))
+        {
+            fprintf(stderr,"%s: entry %ld is damaged\n",file,i);
+            munmap(map,st.st_size);
+            return -1;
+        }
+    rfd=malloc((head->count+1)*sizeof(int));
+    if(rfd==NULL)
+        exit(-1);
+    for(i=0;i<(long)head->count;i++)
+        rfd[i]=-1;
+    rmap=map;
+    rsize=st.st_size;
+    ridx=x;
+    rcount=head->count;
+    debug("replay of %s, %ld entries\n",file,rcount);
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+int replay_active(void)
+{
+    return rmap!=NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief replay_find  Walk path one component at a time: an entry, or a
+ *                     directory known by the entries below it. A link is
+ *                     spliced in as cap_path() did; an absolute target
+ *                     starts again at the archive root, and .. stops there
+ */
+/*--------------------------------------------------------------------------*/
+int replay_find(const char *path, int follow, struct replayent *e)
+{
+    char rest[2*PATH_MAX];
+    char next[2*PATH_MAX];
+    char *cur=e->path;
+    const struct capidx *x=NULL;
+    const char *p;
+    size_t len,curlen=0;
+    long   i=-1;
+    int    depth=0;
+
+    if(snprintf(rest,sizeof(rest),"%s",path)>=(int)sizeof(rest))
+    {
+        errno=ENAMETOOLONG;
+        return -1;
+    }
+    *cur='\0';
+    for(p=rest; ; )
+    {
+        while(*p=='/')
+            p++;
+        if(*p=='\0')
+            break;
+        len=strcspn(p,"/");
+        if(len==1 && *p=='.')
+        {
+            p+=len;
+            continue;
+        }
+        if(len==2 && p[0]=='.' && p[1]=='.')
+        {
+            while(curlen>0 && cur[--curlen]!='/')
+                ;
+            cur[curlen]='\0';
+            i= curlen ? rfind(cur,curlen) : -1;
+            x= i>=0 ? &ridx[i] : NULL;
+            p+=len;
+            continue;
+        }
+        if(x!=NULL && x->type!=CAP_DIR)
+        {
+            errno=ENOTDIR;
+            return -1;
+        }
+        if(curlen+1+len>=PATH_MAX)
+        {
+            errno=ENAMETOOLONG;
+            return -1;
+        }
+        cur[curlen]='/';
+        memcpy(cur+curlen+1,p,len);
+        curlen+=1+len;
+        cur[curlen]='\0';
+        p+=len;
+        i=rfind(cur,curlen);
+        x= i>=0 ? &ridx[i] : NULL;
+        if(x==NULL)
+        {
+            if(!rbelow(cur,curlen))
+            {
+                errno=ENOENT;
+                return -1;
+            }
+            continue;
+        }
+        if(x->type==CAP_LINK && (follow || p[strspn(p,"/")]!='\0'))
+        {
+            if(++depth>CAP_LINKMAX)
+            {
+                errno=ELOOP;
+                return -1;
+            }
+            if(snprintf(next,sizeof(next),"%.*s%s",(int)x->len,(const char *)rmap+x->data,p)
+               >=(int)sizeof(next))
+            {
+                errno=ENAMETOOLONG;
+                return -1;
+            }
+            strcpy(rest,next);
+            p=rest;
+            if(*p=='/')
+                curlen=0;
+            else
+                while(curlen>0 && cur[--curlen]!='/')
+                    ;                   /* relative to the link's directory */
+            cur[curlen]='\0';
+            i= curlen ? rfind(cur,curlen) : -1;
+            x= i>=0 ? &ridx[i] : NULL;
+        }
+    }
+    e->index=i;
+    if(x==NULL)
+    {
+        e->type=CAP_DIR;
+        e->mode=S_IFDIR|0755;
+        e->dev=e->rdev=e->size=0;
+        e->data=NULL;
+        e->len=0;
+        e->index=-1;
+        return 0;
+    }
+    e->type=x->type;
+    e->mode=x->mode;
+    e->dev=x->dev;
+    e->rdev=x->rdev;
+    e->size= x->type==CAP_BLOCK ? x->size : x->len;
+    e->data=(const char *)rmap+x->data;
+    e->len=x->len;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief replay_readdir  The names below dir come in a run of the index,
+ *                        each followed by its own subtree, which is skipped
+ */
+/*--------------------------------------------------------------------------*/
+int replay_readdir(const char *dir, long *cursor, struct dirent *de)
+{
+    char pre[PATH_MAX+1];
+    const char *p;
+    size_t plen,n;
+    long   i;
+
+    plen=snprintf(pre,sizeof(pre),"%s/",dir);
+    if(plen>=sizeof(pre))
+        return 0;
+    i= *cursor<0 ? rlower(pre,plen) : *cursor;
+    if(i>=rcount || ridx[i].pathlen<=plen || memcmp(rpath(i),pre,plen))
+    {
+        *cursor=rcount;
+        return 0;
+    }
+    p=rpath(i);
+    for(n=0;plen+n<ridx[i].pathlen && p[plen+n]!='/';n++)
+        ;
+    memset(de,0,sizeof(*de));
+    memcpy(de->d_name,p+plen,n);
+    de->d_ino=i+1;
+    de->d_type= plen+n==ridx[i].pathlen ? IFTODT(ridx[i].mode) : DT_DIR;
+    if(de->d_type==DT_UNKNOWN)
+        de->d_type= ridx[i].type==CAP_DIR ? DT_DIR : ridx[i].type==CAP_LINK ? DT_LNK : DT_REG;
+    for(i++;i<rcount && ridx[i].pathlen>=plen+n && !memcmp(rpath(i),p,plen+n)
+            && (ridx[i].pathlen==plen+n || rpath(i)[plen+n]=='/');i++)
+        ;
+    *cursor=i;
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/* the bytes of a file, or the ranges of a device at their offsets        */
+static int replay_fill(int fd, const struct replayent *e)
+{
+    const unsigned char *data=(const unsigned char *)e->data;
+    const unsigned char *end=data+e->len;
+    struct caprange r;
+
+    if(e->type==CAP_FILE)
+        return write(fd,data,e->len)!=(ssize_t)e->len;
+    if(ftruncate(fd,e->size))
+        return -1;
+    while(data+sizeof(r)<=end)
+    {
+        memcpy(&r,data,sizeof(r));
+        data+=sizeof(r);
+        if(r.len>(uint64_t)(end-data) || r.off>e->size || r.len>e->size-r.off)
+            break;
+        if(pwrite(fd,data,r.len,r.off)!=(ssize_t)r.len)
+            return -1;
+        data+=r.len;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief replay_fd  A sparse memfd of the size of the device holding the
+ *                   captured ranges, made once per entry. The descriptors
+ *                   given out are dup()s: they share the offset, and
+ *                   parttable.c and fsprobe.c only pread()
+ */
+/*--------------------------------------------------------------------------*/
+int replay_fd(const struct replayent *e)
+{
+    int fd;
+
+    if(e->index<0 || (e->type!=CAP_FILE && e->type!=CAP_BLOCK))
+    {
+        errno= e->type==CAP_DIR ? EISDIR : ELOOP;
+        return -1;
+    }
+    if(rfd[e->index]<0)
+    {
+        fd=memfd_create("fstabxref-replay",MFD_CLOEXEC);
+        if(fd<0)
+            return -1;
+        if(replay_fill(fd,e))
+        {
+            close(fd);
+            return -1;
+        }
+        rfd[e->index]=fd;
+    }
+    return fcntl(rfd[e->index],F_DUPFD_CLOEXEC,0);
+}
+
+/*-------------------------------------------------------------------------*/
+void replay_close(void)
+{
+    long i;
+
+    if(rmap==NULL)
+        return;
+    for(i=0;i<rcount;i++)
+        if(rfd[i]>=0)
+            close(rfd[i]);
+    free(rfd);
+    munmap((void *)rmap,rsize);
+    rfd=NULL;
+    rmap=NULL;
+    ridx=NULL;
+    rcount=0;
+    rsize=0;
+}
@@ -0,0 +1,113 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    capture.h
+   @author  Leslie Satenstein
+   @brief   Capture a host's device environment into one file and replay it.
+
+   capture_write() records everything discovery reads: the /dev/disk/by-*
+   links, the /sys/class/block and /sys/block entries with the attributes
+   used by multipath, parttable, loopdev, devtable and sysattr, the udev
+   database entries, /proc/partitions, the fstab and the paths it names,
+   the fstab.d fragments, crypttab and unit files read by -a (inputs.h),
+   and the superblock ranges of every block device (the first 68 KiB and
+   the last 256 KiB, which hold the MBR, the GPT and its backup, and the
+   ext, xfs, vfat, ntfs, swap and btrfs superblocks). Symbolic links are
+   kept as links, so sysfs paths such as ../queue/rotational still
+   resolve. Each path keeps its st_mode, st_dev and st_rdev.
+
+   The archive is a sorted index followed by the paths and the data
+       header   "FSXCAP2\n", entry count
+       index    one struct capidx per path, sorted by path component by
+                component, so the entries below a directory follow it
+       blob     paths, file contents, link targets, device ranges
+   It is written in host byte order and replayed on the same architecture.
+
+   replay_open() maps the archive, checks every index entry once, and
+   from then on the sysroot_*() functions (sysroot.h) answer from the
+   mapping: a path is found by binary search, its links resolved inside
+   the archive the way RESOLVE_IN_ROOT resolves them in a --root, files
+   are read with fmemopen() in place, directories are listed from the
+   index and sysroot_statx() returns the recorded device numbers, so
+   filedev_fill() (loopdev.h) gives the notes of the captured host. Only
+   a block device is copied, once, into a memfd holding its ranges, as
+   parttable.c and fsprobe.c pread() and ioctl() a descriptor. Nothing
+   is read from the running system and nothing is written. make
+   replaytest times a live discovery of this host against its replay.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include "dictionary.h"
+#include <dirent.h>
+#include <limits.h>
+
+enum { CAP_DIR='D', CAP_FILE='F', CAP_LINK='L', CAP_BLOCK='B' };
+
+/** A replayed path, its data in the mapping */
+struct replayent
+{
+    int         type;                   /** CAP_xxx                         */
+    uint32_t    mode;                   /** st_mode                         */
+    uint64_t    dev,rdev;               /** st_dev, st_rdev                 */
+    uint64_t    size;                   /** of a block device or image      */
+    const char *data;                   /** contents, link target, ranges   */
+    size_t      len;
+    long        index;                  /** entry, -1 for a directory only  */
+                                        /** known by the paths below it     */
+    char        path[PATH_MAX];         /** links resolved                  */
+};
+
+/**
+ * @brief capture_write  Snapshot the device environment, under the current
+ *                       --root if any
+ * @param file           archive to write
+ * @param fstab          the fstab to include
+ * @return               number of paths captured, -1 on error
+ */
+int capture_write(const char *file, const char *fstab);
+
+/**
+ * @brief replay_open  Map an archive, later sysroot_*() calls read from it
+ * @param file         archive written by capture_write()
+ * @return             0 if Ok, -1 if it can not be read or is damaged
+ */
+int replay_open(const char *file);
+
+/**
+ * @brief replay_active  1 between replay_open() and replay_close()
+ */
+int replay_active(void);
+
+/**
+ * @brief replay_find  Look a path up, links resolved inside the archive
+ * @param follow       also resolve a link in the last component
+ * @return             0 if Ok, -1 with errno set
+ */
+int replay_find(const char *path, int follow, struct replayent *e);
+
+/**
+ * @brief replay_readdir  Next entry of the directory dir, a path as
+ *                        replay_find() resolves it
+ * @param cursor          -1 for the first entry
+ * @return                1 with de filled, 0 at the end
+ */
+int replay_readdir(const char *dir, long *cursor, struct dirent *de);
+
+/**
+ * @brief replay_fd  A descriptor reading the file or device of e
+ * @return           -1 with errno set for a directory or a link
+ */
+int replay_fd(const struct replayent *e);
+
+/**
+ * @brief replay_close  Unmap the archive, back to the running system
+ */
+void replay_close(void);
+
+#endif
@@ -0,0 +1,309 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    colexport.c
+   @author  Leslie Satenstein
+   @brief   Column oriented export writer (see colexport.h)
+
+   The rows of the current row group are held column by column; a full
+   group is written as one chunk per column. The dictionaries grow for
+   the whole file and are written with the footer; a string is interned
+   (intern.h) and its intern id indexes an array of codes, so equal
+   strings are found without a table of their own.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "colexport.h"
+#include "mntopt.h"
+#include "intern.h"
+
+struct strbuf                           /* growing byte buffer */
+{
+    char  *p;
+    size_t n,size;
+};
+
+struct coldict
+{
+    struct strbuf bytes;                /* the strings, NUL terminated */
+    uint64_t *off;                      /* code to offset in bytes */
+    uint32_t  n,size;
+    uint32_t *byid;                     /* intern id to code+1, 0 if none */
+    uint32_t  nid;
+};
+
+struct _colwriter_
+{
+    FILE    *f;
+    uint64_t rows;
+    uint32_t grows;                     /* rows in the current group */
+    int      err;
+    struct coldict  dict[COL_NCOLS];
+    uint32_t       *code[COL_NCOLS];    /* COL_DICT, this group */
+    struct strbuf   plain[COL_NCOLS];   /* COL_PLAIN bytes, this group */
+    uint32_t       *poff[COL_NCOLS];    /* COL_PLAIN offsets */
+    int32_t        *ival[COL_NCOLS];    /* COL_INT */
+    struct colgroup *group;
+    uint32_t        ngroups,gsize;
+};
+
+static const struct { const char *name; int enc; } cols[COL_NCOLS]=
+{
+    [COL_HOST] ={ "host",    COL_DICT  },
+    [COL_SPEC] ={ "spec",    COL_PLAIN },
+    [COL_MOUNT]={ "mount",   COL_PLAIN },
+    [COL_TYPE] ={ "type",    COL_DICT  },
+    [COL_OPTS] ={ "options", COL_DICT  },
+    [COL_DEV]  ={ "device",  COL_DICT  },
+    [COL_DUMP] ={ "dump",    COL_INT   },
+    [COL_PASS] ={ "pass",    COL_INT   },
+    [COL_CANON]={ "canonical",COL_DICT },
+};
+
+/*--------------------------------------------------------------------------*/
+/* realloc(), exits when out of memory                                     */
+static void *grow(void *p, size_t size)
+{
+    p=realloc(p,size);
+    if(p==NULL)
+        exit(-1);
+    return p;
+}
+
+/*--------------------------------------------------------------------------*/
+static void buf_put(struct strbuf *b, const void *s, size_t len)
+{
+    if(b->n+len>b->size)
+    {
+        while(b->n+len>b->size)
+            b->size= b->size ? 2*b->size : 4096;
+        b->p=grow(b->p,b->size);
+    }
+    memcpy(b->p+b->n,s,len);
+    b->n+=len;
+}
+
+/*--------------------------------------------------------------------------*/
+/* the code of s in d, added if new                                        */
+static uint32_t dict_code(struct coldict *d, const char *s)
+{
+    const char *is=intern(s);
+    uint32_t id,len;
+
+    if(is==NULL)
+        exit(-1);
+    id=intern_id(is);
+    if(id>=d->nid)
+    {
+        for(len= d->nid ? 2*d->nid : 256; len<=id; len*=2)
+            ;
+        d->byid=grow(d->byid,len*sizeof(uint32_t));
+        memset(d->byid+d->nid,0,(len-d->nid)*sizeof(uint32_t));
+        d->nid=len;
+    }
+    if(d->byid[id])
+        return d->byid[id]-1;
+    if(d->n+1>=d->size)
+    {
+        d->size= d->size ? 2*d->size : 256;
+        d->off=grow(d->off,d->size*sizeof(uint64_t));
+    }
+    d->off[d->n]=d->bytes.n;
+    buf_put(&d->bytes,is,strlen(is)+1);
+    d->byid[id]=++d->n;
+    return d->n-1;
+}
+
+/*--------------------------------------------------------------------------*/
+/* write len bytes and pad to 8, the offset written at in *off             */
+static void put(colwriter *w, const void *p, size_t len, uint64_t *off)
+{
+    static const char zero[8];
+    long pos;
+
+    pos=ftell(w->f);
+    if(off!=NULL)
+        *off=pos;
+    if(len && fwrite(p,1,len,w->f)!=len)
+        w->err=1;
+    if((pos+len)%8 && fwrite(zero,1,8-(pos+len)%8,w->f)!=8-(pos+len)%8)
+        w->err=1;
+}
+
+static void group_flush(colwriter *w)
+{
+    struct colgroup *g;
+    struct colchunk *ch;
+    uint32_t i;
+    int c;
+
+    if(w->grows==0)
+        return;
+    if(w->ngroups==w->gsize)
+    {
+        w->gsize= w->gsize ? 2*w->gsize : 16;
+        w->group=grow(w->group,w->gsize*sizeof(struct colgroup));
+    }
+    g=&w->group[w->ngroups++];
+    memset(g,0,sizeof(*g));
+    g->first=w->rows-w->grows;
+    g->rows=w->grows;
+    for(c=0;c<COL_NCOLS;c++)
+    {
+        ch=&g->col[c];
+        switch(cols[c].enc)
+        {
+        case COL_DICT:
+            ch->len=w->grows*sizeof(uint32_t);
+            put(w,w->code[c],ch->len,&ch->off);
+            break;
+        case COL_PLAIN:
+            w->poff[c][w->grows]=w->plain[c].n;
+            ch->len=(w->grows+1)*sizeof(uint32_t);
+            put(w,w->poff[c],ch->len,&ch->off);
+            put(w,w->plain[c].p,w->plain[c].n,NULL);
+            ch->len=(ch->len+7)/8*8+w->plain[c].n;
+            w->plain[c].n=0;
+            break;
+        case COL_INT:
+            ch->len=w->grows*sizeof(int32_t);
+            ch->min=ch->max=w->ival[c][0];
+            for(i=1;i<w->grows;i++)
+            {
+                if(w->ival[c][i]<ch->min)
+                    ch->min=w->ival[c][i];
+                if(w->ival[c][i]>ch->max)
+                    ch->max=w->ival[c][i];
+            }
+            put(w,w->ival[c],ch->len,&ch->off);
+            break;
+        }
+    }
+    w->grows=0;
+}
+
+/*-------------------------------------------------------------------------*/
+colwriter *colexport_open(const char *file)
+{
+    struct colhead h;
+    colwriter *w;
+    int c;
+
+    w=calloc(1,sizeof(colwriter));
+    if(w==NULL)
+        exit(-1);
+    w->f=fopen(file,"wb");
+    if(w->f==NULL)
+    {
+        free(w);
+        return NULL;
+    }
+    for(c=0;c<COL_NCOLS;c++)
+    {
+        if(cols[c].enc==COL_DICT)
+            w->code[c]=grow(NULL,COL_GROUPROWS*sizeof(uint32_t));
+        else if(cols[c].enc==COL_PLAIN)
+            w->poff[c]=grow(NULL,(COL_GROUPROWS+1)*sizeof(uint32_t));
+        else
+            w->ival[c]=grow(NULL,COL_GROUPROWS*sizeof(int32_t));
+    }
+    memset(&h,0,sizeof(h));             /* written again by colexport_close() */
+    put(w,&h,sizeof(h),NULL);
+    return w;
+}
+
+/*-------------------------------------------------------------------------*/
+int colexport_row(colwriter *w, const char *host, const char *spec, const char *mount,
+                  const char *type, const char *opts, const char *dev, int dump, int pass)
+{
+    const char *s[COL_NCOLS]={ host, spec, mount, type, opts, dev };
+    int v[COL_NCOLS]={ [COL_DUMP]=dump, [COL_PASS]=pass };
+    int c;
+
+    s[COL_CANON]=mntopt_canon(mntopt_set(opts ? opts : "",type ? type : ""));
+
+    for(c=0;c<COL_NCOLS;c++)
+    {
+        switch(cols[c].enc)
+        {
+        case COL_DICT:
+            w->code[c][w->grows]=dict_code(&w->dict[c],s[c] ? s[c] : "");
+            break;
+        case COL_PLAIN:
+            w->poff[c][w->grows]=w->plain[c].n;
+            buf_put(&w->plain[c],s[c] ? s[c] : "",s[c] ? strlen(s[c]) : 0);
+            break;
+        case COL_INT:
+            w->ival[c][w->grows]=v[c];
+            break;
+        }
+    }
+    w->rows++;
+    if(++w->grows==COL_GROUPROWS)
+        group_flush(w);
+    return w->err ? -1 : 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief colexport_close  Last group, dictionaries, footer, then the
+ *                         header at offset 0
+ */
+/*--------------------------------------------------------------------------*/
+long colexport_close(colwriter *w)
+{
+    struct colmeta meta[COL_NCOLS];
+    struct colhead h;
+    uint32_t cnt[2];
+    long rows;
+    int c;
+
+    group_flush(w);
+    memset(meta,0,sizeof(meta));
+    for(c=0;c<COL_NCOLS;c++)
+    {
+        strncpy(meta[c].name,cols[c].name,sizeof(meta[c].name));
+        meta[c].enc=cols[c].enc;
+        if(cols[c].enc!=COL_DICT)
+            continue;
+        cnt[0]=w->dict[c].n;
+        cnt[1]=0;
+        w->dict[c].off=grow(w->dict[c].off,(w->dict[c].n+1)*sizeof(uint64_t));
+        w->dict[c].off[w->dict[c].n]=w->dict[c].bytes.n;
+        put(w,cnt,sizeof(cnt),&meta[c].dict);
+        put(w,w->dict[c].off,(w->dict[c].n+1)*sizeof(uint64_t),NULL);
+        put(w,w->dict[c].bytes.p,w->dict[c].bytes.n,NULL);
+        meta[c].dictlen=ftell(w->f)-meta[c].dict;
+    }
+
+    memset(&h,0,sizeof(h));
+    memcpy(h.magic,COL_MAGIC,sizeof(h.magic));
+    h.version=COL_VERSION;
+    h.ncols=COL_NCOLS;
+    h.rows=w->rows;
+    h.ngroups=w->ngroups;
+    put(w,meta,sizeof(meta),&h.footer);
+    put(w,w->group,w->ngroups*sizeof(struct colgroup),NULL);
+    h.footerlen=ftell(w->f)-h.footer;
+    if(fseek(w->f,0,SEEK_SET) || fwrite(&h,sizeof(h),1,w->f)!=1)
+        w->err=1;
+    if(fclose(w->f))
+        w->err=1;
+
+    rows= w->err ? -1 : (long)w->rows;
+    for(c=0;c<COL_NCOLS;c++)
+    {
+        free(w->dict[c].bytes.p);
+        free(w->dict[c].off);
+        free(w->dict[c].byid);
+        free(w->code[c]);
+        free(w->plain[c].p);
+        free(w->poff[c]);
+        free(w->ival[c]);
+    }
+    free(w->group);
+    free(w);
+    return rows;
+}
@@ -0,0 +1,114 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    colexport.h
+   @author  Leslie Satenstein
+   @brief   Column oriented export of the annotated entries (--export).
+
+   One row per fstab entry: host, spec, mount, type, options, device,
+   dump, pass, and the options in canonical form (mntopt.h), so rows
+   with the same effective options share one dictionary code.
+
+   The file is meant to be mmap()ed; every part starts on an 8 byte
+   boundary and numbers are in the byte order of the writer
+   (colhead.version reads 2 only in the same order).
+
+       header      struct colhead, 64 bytes, at offset 0
+       row groups  up to COL_GROUPROWS rows each, one chunk per column
+       footer      struct colmeta[COL_NCOLS]
+                   struct colgroup[ngroups]
+                   the string dictionaries
+
+   Column chunks, by encoding:
+       COL_DICT    uint32 code[rows], an index into the column dictionary
+                   host, type, options, device, canonical
+       COL_PLAIN   uint32 off[rows+1] padded to 8 bytes, then the bytes,
+                   off relative to the first byte; spec, mount (nearly
+                   all different)
+       COL_INT     int32 value[rows]; dump, pass, with min and max per
+                   row group in struct colgroup
+   A dictionary is uint32 count, uint32 0, uint64 off[count+1], then
+   count NUL terminated strings, off relative to the first string.
+
+   A reader maps the file, reads the footer from colhead.footer, and
+   touches only the chunks of the columns it wants: a scan of device
+   and pass reads those two chunks per row group and one dictionary.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _COLEXPORT_H_
+#define _COLEXPORT_H_
+
+#include "dictionary.h"
+#include <stdint.h>
+
+#define COL_MAGIC      "FSTABCOL"
+#define COL_VERSION    2
+#define COL_GROUPROWS  65536    /* rows per row group */
+
+enum col_id   { COL_HOST, COL_SPEC, COL_MOUNT, COL_TYPE, COL_OPTS, COL_DEV,
+                COL_DUMP, COL_PASS, COL_CANON, COL_NCOLS };
+enum col_enc  { COL_PLAIN, COL_DICT, COL_INT };
+
+struct colhead
+{
+    char     magic[8];          /** COL_MAGIC, not NUL terminated         */
+    uint32_t version;           /** COL_VERSION                           */
+    uint32_t ncols;             /** COL_NCOLS                             */
+    uint64_t rows;
+    uint32_t ngroups;
+    uint32_t pad;
+    uint64_t footer;            /** offset of the colmeta array           */
+    uint64_t footerlen;
+    uint8_t  reserved[16];
+};
+
+struct colmeta
+{
+    char     name[16];          /** "host", "spec" ... NUL padded         */
+    uint32_t enc;               /** enum col_enc                          */
+    uint32_t pad;
+    uint64_t dict;              /** offset of the dictionary, COL_DICT    */
+    uint64_t dictlen;
+};
+
+struct colchunk
+{
+    uint64_t off;               /** offset of the chunk in the file       */
+    uint64_t len;               /** its length in bytes                   */
+    int32_t  min,max;           /** COL_INT only                          */
+};
+
+struct colgroup
+{
+    uint64_t first;             /** number of the first row               */
+    uint32_t rows;
+    uint32_t pad;
+    struct colchunk col[COL_NCOLS];
+};
+
+typedef struct _colwriter_ colwriter;
+
+/**
+ * @brief colexport_open  Create the export file
+ * @return                the writer, NULL if file can not be created
+ */
+colwriter *colexport_open(const char *file);
+
+/**
+ * @brief colexport_row  Add one entry, NULL strings are written as ""
+ * @return               0 if Ok, -1 on a write error
+ */
+int colexport_row(colwriter *w, const char *host, const char *spec, const char *mount,
+                  const char *type, const char *opts, const char *dev, int dump, int pass);
+
+/**
+ * @brief colexport_close  Write the last row group and the footer
+ * @return                 number of rows, -1 on a write error
+ */
+long colexport_close(colwriter *w);
+
+#endif
@@ -0,0 +1,95 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    conflict.c
+   @author  Leslie Satenstein
+   @brief   fstab conflict checks (see conflict.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "conflict.h"
+#include "pathtrie.h"
+
+struct _conflict_
+{
+    dictionary *devs;                   /* device to "line mountpoint" */
+    pathtrie   *mnts;                   /* mountpoint to line */
+};
+
+/*--------------------------------------------------------------------------*/
+conflict *conflict_new(void)
+{
+    conflict *c;
+
+    c=calloc(1,sizeof(conflict));
+    if(c==NULL)
+        exit(-1);
+    c->devs=dictionary_new(32,"conflict");
+    c->mnts=pathtrie_new();
+    if(c->devs==NULL || c->mnts==NULL)
+        exit(-1);
+    return c;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief conflict_check  The device set, then the trie: an exact match
+ *                        shadows, an entry below is hidden
+ */
+/*--------------------------------------------------------------------------*/
+int conflict_check(conflict *c, int line, const char *where, const char *type,
+                   const char *dev, char *msg, size_t size)
+{
+    char  val[300];
+    char *seen;
+    int   n=0;
+    int   len=0;
+    int   i;
+
+    *msg='\0';
+    if(*dev!='\0' && strcmp(type,"btrfs"))
+    {
+        seen=dictionary_get(c->devs,dev,NULL);
+        if(seen!=NULL)
+        {
+            len+=snprintf(msg+len,size-len,"%sdevice %s is already mounted by line %s",
+                          n++ ? "; " : "",dev,seen);
+            len= len<(int)size ? len : (int)size-1;
+        }
+        else
+        {
+            snprintf(val,sizeof(val),"%d at %.250s",line,where);
+            dictionary_set(c->devs,dev,val);
+        }
+    }
+    if(*where!='/')
+        return n;                       /* swap */
+    i=pathtrie_lpm(c->mnts,where,0);
+    if(i>=0 && pathtrie_lpm(c->mnts,where,1)!=i)
+    {
+        len+=snprintf(msg+len,size-len,"%s%s is mounted again, line %d is hidden",
+                      n++ ? "; " : "",where,i);
+        len= len<(int)size ? len : (int)size-1;
+    }
+    i=pathtrie_under(c->mnts,where);
+    if(i>=0)
+    {
+        snprintf(msg+len,size-len,"%s%s hides line %d, mounted below it earlier",
+                 n++ ? "; " : "",where,i);
+    }
+    pathtrie_add(c->mnts,where,line);
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+void conflict_del(conflict **c)
+{
+    if(c==NULL || *c==NULL)
+        return;
+    dictionary_del(&(*c)->devs);
+    pathtrie_del(&(*c)->mnts);
+    free(*c);
+    *c=NULL;
+}
@@ -0,0 +1,54 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    conflict.h
+   @author  Leslie Satenstein
+   @brief   fstab conflicts, found while the fstab is annotated.
+
+   Each entry is checked against the entries before it, once, as the
+   annotation reads it:
+       device   the same device mounted twice, e.g. by LABEL= and by UUID=
+                (btrfs is left alone, its subvolumes share the device)
+       shadow   a mountpoint used again, the later mount hides the earlier
+       over     a mount on a parent directory of an earlier entry, /home
+                after /home/alice, hides /home/alice once mounted
+   Devices are kept in a dictionary, mountpoints in a path trie, so an
+   entry costs one lookup and one walk of its path.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _CONFLICT_H_
+#define _CONFLICT_H_
+
+#include "dictionary.h"
+
+typedef struct _conflict_ conflict;
+
+/**
+ * @brief conflict_new  An empty set of seen entries
+ */
+conflict *conflict_new(void);
+
+/**
+ * @brief conflict_check  Check one entry and add it to the set
+ * @param c               the set
+ * @param line            line number of the entry
+ * @param where           mountpoint, decoded, "none" or "swap" for swap
+ * @param type            filesystem type
+ * @param dev             device name, "" if the spec is no block device
+ * @param msg             the conflict found, if any
+ * @param size            room in msg
+ * @return                number of conflicts found for this entry
+ */
+int conflict_check(conflict *c, int line, const char *where, const char *type,
+                   const char *dev, char *msg, size_t size);
+
+/**
+ * @brief conflict_del  Free the set and set *c to NULL
+ */
+void conflict_del(conflict **c);
+
+#endif
@@ -0,0 +1,98 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    devgraph.c
+   @author  Leslie Satenstein
+   @brief   Block device stacking (see devgraph.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "devgraph.h"
+#include "sysroot.h"
+#include <limits.h>
+#include <libgen.h>
+
+#define DEVGRAPH_DEPTH 8        /* dm on dm on md on partition ... */
+
+/*--------------------------------------------------------------------------*/
+static void disk_add(const char *disk, char disks[][32], int max, int *n)
+{
+    int i;
+
+    for(i=0;i<*n;i++)
+        if(!strcmp(disks[i],disk))
+            return;
+    if(*n<max)
+        snprintf(disks[(*n)++],32,"%s",disk);
+}
+
+/*--------------------------------------------------------------------------*/
+static void walk(const char *dev, char disks[][32], int max, int *n, int depth)
+{
+    char  path[PATH_MAX];
+    char  link[PATH_MAX];
+    struct dirent *de;
+    sysdir *dir;
+    FILE *f;
+    int   slaves=0;
+
+    if(depth>DEVGRAPH_DEPTH)
+        return;
+    snprintf(path,sizeof(path),"/sys/class/block/%s/slaves",dev);
+    dir=sysroot_opendir(path);
+    if(dir!=NULL)
+    {
+        while((de=sysroot_readdir(dir))!=NULL)
+        {
+            if(*de->d_name=='.')
+                continue;
+            walk(de->d_name,disks,max,n,depth+1);
+            slaves++;
+        }
+        sysroot_closedir(dir);
+    }
+    if(slaves)
+        return;
+
+    /* a partition's sysfs directory is inside its disk's */
+    snprintf(path,sizeof(path),"/sys/class/block/%s",dev);
+    if(sysroot_readlink(path,link,sizeof(link))<=0)
+        return;                         /* not a block device */
+    snprintf(path,sizeof(path),"/sys/class/block/%s/partition",dev);
+    f=sysroot_fopen(path);
+    if(f==NULL)
+    {
+        disk_add(dev,disks,max,n);
+        return;
+    }
+    fclose(f);
+    walk(basename(dirname(link)),disks,max,n,depth+1);
+}
+
+/*-------------------------------------------------------------------------*/
+int devgraph_disks(const char *dev, char disks[][32], int max)
+{
+    int n=0;
+
+    walk(dev,disks,max,&n,0);
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+int devgraph_rotational(const char *disk)
+{
+    char path[PATH_MAX];
+    FILE *f;
+    int  r=-1;
+
+    snprintf(path,sizeof(path),"/sys/class/block/%s/queue/rotational",disk);
+    f=sysroot_fopen(path);
+    if(f==NULL)
+        return -1;
+    if(fscanf(f,"%d",&r)!=1)
+        r=-1;
+    fclose(f);
+    return r;
+}
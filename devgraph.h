@@ -0,0 +1,42 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    devgraph.h
+   @author  Leslie Satenstein
+   @brief   Block device stacking: from a device to the disks under it.
+
+   A partition sits on its disk, a device mapper or md device on its
+   slaves, which may themselves be partitions or mapped devices:
+       dm-3 -> dm-0 (crypt) -> sdb2 -> sdb
+       md0  -> sdc1 sdd1    -> sdc sdd
+   devgraph_disks() follows /sys/class/block/<dev>/slaves and the
+   partition parent down to the whole disks. Read under --root.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _DEVGRAPH_H_
+#define _DEVGRAPH_H_
+
+#include "dictionary.h"
+
+#define DEVGRAPH_MAX 16         /* disks returned for one device */
+
+/**
+ * @brief devgraph_disks  Whole disks under dev
+ * @param dev             device name, sdb2 or dm-3
+ * @param disks           result, device names
+ * @param max             room in disks
+ * @return                number of disks, 0 if dev is unknown
+ */
+int devgraph_disks(const char *dev, char disks[][32], int max);
+
+/**
+ * @brief devgraph_rotational  1 for a spinning disk, 0 for an ssd, -1 if
+ *                             not known
+ */
+int devgraph_rotational(const char *disk);
+
+#endif
@@ -0,0 +1,201 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    devtable.c
+   @author  Leslie Satenstein
+   @brief   Two level major:minor device table (see devtable.h)
+
+   The minor arrays of a major are grown to the next power of two above
+   the highest minor seen (minimum 16), and new slots are set to -1.
+   sd disks (major 8, minors 0..255) therefore cost 1 KiB.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "devtable.h"
+#include "sysroot.h"
+#include <dirent.h>
+#include <limits.h>
+
+#define DEVTAB_MINRECS 64
+
+/*-------------------------------------------------------------------------*/
+devtable *devtable_new(void)
+{
+    devtable *t;
+
+    t=calloc(1,sizeof(devtable));
+    if(t==NULL)
+        return NULL;
+    t->rec=calloc(DEVTAB_MINRECS,sizeof(struct devrec));
+    if(t->rec==NULL)
+    {
+        free(t);
+        return NULL;
+    }
+    t->size=DEVTAB_MINRECS;
+    return t;
+}
+
+/*--------------------------------------------------------------------------*/
+/* make sure minor[major][minor] exists                                    */
+static int devtable_reserve(devtable *t, unsigned major, unsigned minor)
+{
+    unsigned  len;
+    unsigned  i;
+    int      *p;
+    void     *np;
+
+    if(major>=t->nmajor)
+    {
+        for(len= t->nmajor ? t->nmajor : 16; len<=major; len*=2)
+            ;
+        np=realloc(t->minor,len*sizeof(int *));
+        if(np==NULL)
+            return -1;
+        t->minor=np;
+        np=realloc(t->nminor,len*sizeof(unsigned));
+        if(np==NULL)
+            return -1;
+        t->nminor=np;
+        for(i=t->nmajor;i<len;i++)
+        {
+            t->minor[i]=NULL;
+            t->nminor[i]=0;
+        }
+        t->nmajor=len;
+    }
+    if(minor>=t->nminor[major])
+    {
+        for(len= t->nminor[major] ? t->nminor[major] : 16; len<=minor; len*=2)
+            ;
+        p=realloc(t->minor[major],len*sizeof(int));
+        if(p==NULL)
+            return -1;
+        for(i=t->nminor[major];i<len;i++)
+            p[i]=-1;
+        t->minor[major]=p;
+        t->nminor[major]=len;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief devtable_add  Add or rename the device major:minor
+ */
+/*--------------------------------------------------------------------------*/
+int devtable_add(devtable *t, unsigned major, unsigned minor, const char *name, uint64_t blocks)
+{
+    struct devrec *r;
+    int i;
+
+    if(t==NULL || major>=DEVTAB_MAXMAJOR || minor>=DEVTAB_MAXMINOR)
+        return -1;
+    if(devtable_reserve(t,major,minor))
+    {
+        if(dictionary_flagstatus(error,testflag))
+            fprintf(stderr,"%s: Out of memory\n",__FUNCTION__);
+        return -1;
+    }
+    i=t->minor[major][minor];
+    if(i<0)
+    {
+        if(t->n==t->size)
+        {
+            r=realloc(t->rec,2*t->size*sizeof(struct devrec));
+            if(r==NULL)
+                return -1;
+            t->rec=r;
+            t->size*=2;
+        }
+        i=t->n++;
+        t->minor[major][minor]=i;
+    }
+    r=&t->rec[i];
+    r->major=major;
+    r->minor=minor;
+    r->blocks=blocks;
+    snprintf(r->name,sizeof(r->name),"%s",name);
+    return i;
+}
+
+/*--------------------------------------------------------------------------*/
+/* fallback: every /sys/class/block/<name>/dev holds "MAJ:MIN"             */
+static int devtable_load_sysfs(devtable *t)
+{
+    sysdir *dir;
+    struct dirent *de;
+    char path[PATH_MAX];
+    unsigned major,minor;
+    FILE *f;
+    int n=0;
+
+    dir=sysroot_opendir("/sys/class/block");
+    if(dir==NULL)
+        return 0;
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(*de->d_name=='.')
+            continue;
+        snprintf(path,sizeof(path),"/sys/class/block/%s/dev",de->d_name);
+        f=sysroot_fopen(path);
+        if(f==NULL)
+            continue;
+        if(fscanf(f,"%u:%u",&major,&minor)==2 && devtable_add(t,major,minor,de->d_name,0)>=0)
+            n++;
+        fclose(f);
+    }
+    sysroot_closedir(dir);
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief devtable_load Fill the table from /proc/partitions or sysfs
+ *        /proc/partitions:
+ *        major minor  #blocks  name
+ *           8       17  104857600 sdb1
+ */
+/*--------------------------------------------------------------------------*/
+int devtable_load(devtable *t)
+{
+    FILE *f;
+    char line[256];
+    char name[64];
+    unsigned major,minor;
+    unsigned long long blocks;
+    int n=0;
+
+    f=sysroot_fopen("/proc/partitions");
+    if(f==NULL)
+        return devtable_load_sysfs(t);
+    while(fgets(line,sizeof(line),f)!=NULL)
+    {
+        if(sscanf(line,"%u %u %llu %63s",&major,&minor,&blocks,name)!=4)
+            continue;
+        if(devtable_add(t,major,minor,name,blocks)>=0)
+            n++;
+    }
+    fclose(f);
+    debug("%d devices loaded\n",n);
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+void devtable_del(devtable **vt)
+{
+    devtable *t=*vt;
+    unsigned i;
+
+    if(t==NULL)
+        return;
+    for(i=0;i<t->nmajor;i++)
+        free(t->minor[i]);
+    free(t->minor);
+    free(t->nminor);
+    free(t->rec);
+    free(t);
+    *vt=NULL;
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    devtable.h
+   @author  Leslie Satenstein
+   @brief   Device number (dev_t) to device record table.
+
+   filedev_fill() in loopdev.c, its only user, turns the st_rdev of a
+   block device and the st_dev of a regular file named in fstab into a
+   device name. Formatting those numbers as "MAJ:MIN" strings to hash
+   them into the dictionary is wasteful, so this table is indexed
+   directly: a first level array indexed by major holds, per major, a
+   dense array indexed by minor giving the index of the device record. A
+   lookup is two array loads and a bounds check. The dictionary still
+   gets the LOOPDEV=, LOOP= and path keys of loopdev.c, only no "MAJ:MIN"
+   keys.
+
+   The table is loaded from /proc/partitions, or from the sysfs "dev"
+   files under /sys/class/block when /proc is not available.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _DEVTABLE_H_
+#define _DEVTABLE_H_
+
+#include "dictionary.h"
+
+#define DEVTAB_MAXMAJOR 4096            /** 12 bit major numbers            */
+#define DEVTAB_MAXMINOR (1<<20)         /** 20 bit minor numbers            */
+
+/** One block device */
+struct devrec
+{
+    unsigned  major;
+    unsigned  minor;
+    uint64_t  blocks;                   /** 1 KiB blocks, /proc/partitions */
+    char      name[32];                 /** sda2, dm-3, nvme0n1p1          */
+};
+
+typedef struct _devtable_
+{
+    int          **minor;   /** minor[major] -> record index per minor, -1 */
+    unsigned      *nminor;  /** allocated length of each minor[] array     */
+    unsigned       nmajor;  /** allocated length of minor and nminor       */
+    struct devrec *rec;     /** device records                             */
+    int            n;       /** number of records                          */
+    int            size;    /** allocated records                          */
+} devtable;
+
+/**
+ * @brief devtable_new  Create an empty table
+ */
+devtable *devtable_new(void);
+
+/**
+ * @brief devtable_load Fill the table from /proc/partitions or sysfs
+ * @return              number of devices loaded
+ */
+int devtable_load(devtable *t);
+
+/**
+ * @brief devtable_add  Add or rename the device major:minor
+ * @return              record index, -1 if out of range or out of memory
+ */
+int devtable_add(devtable *t, unsigned major, unsigned minor, const char *name, uint64_t blocks);
+
+/**
+ * @brief devtable_find Record index of major:minor, -1 if unknown
+ */
+static inline int devtable_find(const devtable *t, unsigned major, unsigned minor)
+{
+    if(t==NULL || major>=t->nmajor || t->minor[major]==NULL || minor>=t->nminor[major])
+        return -1;
+    return t->minor[major][minor];
+}
+
+/**
+ * @brief devtable_name Device name of major:minor, NULL if unknown
+ */
+static inline const char *devtable_name(const devtable *t, unsigned major, unsigned minor)
+{
+    int i=devtable_find(t,major,minor);
+    return i<0 ? NULL : t->rec[i].name;
+}
+
+/**
+ * @brief devtable_del  Free the table and set the pointer to NULL
+ */
+void devtable_del(devtable **t);
+
+#endif
@@ -0,0 +1,150 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictbench.c
+   @author  Leslie Satenstein
+   @brief   Lookup throughput of many large dictionaries, with and without
+            a Bloom filter.
+
+   dictbench [hosts [keys [rows [lookups]]]]
+
+   Builds one dictionary per host, like a fleet run, each created with
+   room for rows rows and holding keys UUID keys, then times random
+   dictionary_get() calls across all of them, for keys they hold and for
+   keys none holds, and one scan of every row. This is repeated with a
+   Bloom filter (dictionary_bloom) of 8 and of 12 bits per key, with its
+   false positive rate. After the first run the intern table (intern.h)
+   is reported: the bytes the keys and values take against the bytes the
+   dictionary_set() calls passed in.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "dictionary.h"
+#include "intern.h"
+#include <time.h>
+
+#define PROBES 256                      /* keys looked up per host */
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+static unsigned long long rnd;
+
+static unsigned next(void)
+{
+    rnd=rnd*6364136223846793005ULL+1442695040888963407ULL;
+    return rnd>>33;
+}
+
+/*--------------------------------------------------------------------------*/
+static void bench(const char *name, unsigned bits, int hosts, int keys, int rows,
+                  long lookups)
+{
+    dictionary **d;
+    char   key[40];
+    char (*probe)[40];
+    double t,build,get,miss,scan;
+    long   found=0,live=0;
+    int    h,i,fp=0;
+
+    d=calloc(hosts,sizeof(dictionary *));
+    probe=calloc((size_t)hosts*PROBES,40);
+    if(d==NULL || probe==NULL)
+        exit(1);
+    rnd=1;
+    t=now();
+    for(h=0;h<hosts;h++)
+    {
+        d[h]=dictionary_new(rows,"bench");
+        for(i=0;i<keys;i++)
+        {
+            sprintf(key,"%08x-%04x-%04x-%04x-%04x%08x",next(),next()&0xFFFF,next()&0xFFFF,
+                    next()&0xFFFF,next()&0xFFFF,next());
+            dictionary_set(d[h],key,"sdb2");        /* 16 bit hash: some refused */
+            if(i%(keys/PROBES+1)==0)
+                strcpy(probe[h*PROBES+i/(keys/PROBES+1)],key);
+        }
+        dictionary_getIndex(d[h],"");               /* sort before timing */
+        if(bits)
+            dictionary_bloom(d[h],bits);
+    }
+    build=now()-t;
+
+    t=now();
+    for(i=0;i<lookups;i++)
+    {
+        h=next()%hosts;
+        found+= dictionary_get(d[h],probe[h*PROBES+next()%PROBES],NULL)!=NULL;
+    }
+    get=lookups/(now()-t);
+
+    /* keys of no host: the fleet audit case */
+    for(i=0;i<PROBES;i++)
+        sprintf(probe[i],"%08x-%04x-%04x-%04x-%04x%08x",next(),next()&0xFFFF,next()&0xFFFF,
+                next()&0xFFFF,next()&0xFFFF,next());
+    t=now();
+    for(i=0;i<lookups;i++)
+        found+= dictionary_get(d[next()%hosts],probe[next()%PROBES],NULL)!=NULL;
+    miss=lookups/(now()-t);
+
+    t=now();
+    for(h=0;h<hosts;h++)
+        for(i=0;i<d[h]->size;i++)
+            live+= d[h]->key[i]!=NULL;
+    scan=live/(now()-t);
+
+    /* counted apart, the timed loops run without the counters */
+    for(h=0;h<hosts && bits;h++)
+    {
+        dictionary_bloomcount(d[h],1);
+        for(i=0;i<PROBES;i++)
+            dictionary_get(d[h],probe[i],NULL);
+        fp+=dictionary_bloomstats(d[h],NULL);
+    }
+    printf("%-14s build %6.2fs  %9.0f hits/s  %9.0f misses/s  %11.0f rows/s scanned",
+           name,build,get,miss,scan);
+    if(bits)
+        printf("  %.2f%% false positives",fp/(10.0*hosts));
+    printf("\n");
+    for(h=0;h<hosts;h++)
+        dictionary_del(&d[h]);
+    free(d);
+    free(probe);
+    if(bits==0)
+        intern_stats(stdout);
+    intern_free();                      /* the next run starts empty */
+}
+
+/*--------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    int  hosts=32;
+    int  keys=20000;
+    int  rows=1<<18;
+    long lookups=5000000;
+
+    if(argc>1)
+        hosts=atoi(argv[1]);
+    if(argc>2)
+        keys=atoi(argv[2]);
+    if(argc>3)
+        rows=atoi(argv[3]);
+    if(argc>4)
+        lookups=atol(argv[4]);
+    if(hosts<=0 || keys<=0 || rows<keys || lookups<=0)
+    {
+        fprintf(stderr,"usage: dictbench [hosts [keys [rows [lookups]]]]\n");
+        exit(2);
+    }
+    bench("no filter",0,hosts,keys,rows,lookups);
+    bench("bloom 8",8,hosts,keys,rows,lookups);
+    bench("bloom 12",12,hosts,keys,rows,lookups);
+    return 0;
+}
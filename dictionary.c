@@ -101,6 +101,9 @@ unsigned integer   introduced as appropriate
 dictionary_set will not do free/realloc for redefinition of a field value
                 if it fits within the original allocation.
 void *dictionary_ffree(void **ptr); to free *ptr and to set ptr to NULL
+Keys and values are interned (intern.h), not strdup()ed: a UUID stored in
+several namespaces and a device named by several keys are one copy, and
+a value is replaced by swapping the pointer.
 (simplified some code)
 dictionary_media() code to indicate dictionary size, and available slots
 Added #ifdef WANT_....  to allow shrinking the code size.
@@ -111,6 +114,7 @@ Added #ifdef WANT_....  to allow shrinking the code size.
  ---------------------------------------------------------------------------*/
 
 #include "dictionary.h"
+#include "intern.h"
 /* included in dictionary.h 
  #include <stdio.h>
  #include <stdlib.h>
@@ -121,6 +125,8 @@ Added #ifdef WANT_....  to allow shrinking the code size.
 /*(refer to dictionary.h for definition) of HAS_STRDUP */
 
 static void * dictionary_realloc(void * ptr, int size,int bytes);
+static int    bloom_maybe(struct _dictbloom_ *b, const char *key, size_t len);
+static void   bloom_add(dictionary *d, const char *key);
 
 int main(int , char **);
 
@@ -132,6 +138,95 @@ int main(int , char **);
                             Private functions
  ---------------------------------------------------------------------------*/
 
+/* The Bloom filter: a 64 bit hash of the key picks one 64 byte block
+ * (512 bits) and k bits in it, by double hashing. Sized for cap keys
+ * at the bits per key asked for.                                       */
+#define BLOOM_BLOCK     512
+
+struct _dictbloom_
+{
+    uint64_t *bits;             /* nblocks*8 words, 64 byte aligned */
+    uint32_t  nblocks;
+    unsigned  k;
+    unsigned  bitsperkey;
+    int       keys,cap;
+    int       counting;         /* dictionary_bloomcount()          */
+    unsigned long lookups;      /* only while counting, relaxed      */
+    unsigned long rejected;     /* atomics: readers share the filter */
+    unsigned long falsepos;     /* passed the filter, not in the table */
+};
+
+/* lookups through a const dictionary * may run in many threads at once */
+#define BLOOM_COUNT(b,field) \
+    do { if((b)->counting) __atomic_fetch_add(&(b)->field,1,__ATOMIC_RELAXED); } while(0)
+
+static uint64_t bloom_hash(const char *key, size_t len)
+{
+    uint64_t h=0xcbf29ce484222325ULL;
+
+    while(len--)
+        h=(h^(unsigned char)*key++)*0x100000001b3ULL;
+    h^=h>>33;                   /* the murmur3 finalizer */
+    h*=0xff51afd7ed558ccdULL;
+    h^=h>>33;
+    h*=0xc4ceb9fe1a85ec53ULL;
+    h^=h>>33;
+    return h;
+}
+
+static uint64_t * bloom_block(const struct _dictbloom_ *b, uint64_t h)
+{
+    return b->bits+((h>>32)*b->nblocks>>32)*(BLOOM_BLOCK/64);
+}
+
+static void bloom_set(struct _dictbloom_ *b, const char *key)
+{
+    uint64_t  h=bloom_hash(key,strlen(key));
+    uint64_t *blk=bloom_block(b,h);
+    uint32_t  h1=(uint32_t)h;
+    uint32_t  h2=(uint32_t)(h*0x9e3779b97f4a7c15ULL>>32)|1;
+    unsigned  i,bit;
+
+    for(i=0;i<b->k;i++)
+    {
+        bit=(h1+i*h2)%BLOOM_BLOCK;
+        blk[bit/64]|=1ULL<<(bit%64);
+    }
+    b->keys++;
+}
+
+static int bloom_maybe(struct _dictbloom_ *b, const char *key, size_t len)
+{
+    uint64_t  h=bloom_hash(key,len);
+    const uint64_t *blk=bloom_block(b,h);
+    uint32_t  h1=(uint32_t)h;
+    uint32_t  h2=(uint32_t)(h*0x9e3779b97f4a7c15ULL>>32)|1;
+    unsigned  i,bit;
+
+    BLOOM_COUNT(b,lookups);
+    for(i=0;i<b->k;i++)
+    {
+        bit=(h1+i*h2)%BLOOM_BLOCK;
+        if(!(blk[bit/64]>>(bit%64)&1))
+        {
+            BLOOM_COUNT(b,rejected);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* a new key; past twice the keys the filter was sized for, rebuild it */
+static void bloom_add(dictionary *d, const char *key)
+{
+    if(d->bloom==NULL)
+        return;
+    if(d->bloom->keys<2*d->bloom->cap)
+        bloom_set(d->bloom,key);
+    else
+        dictionary_bloom(d,d->bloom->bitsperkey);
+}
+
 /* If you are adding more entries than the initial allocated previsions
  * This function is called to double the allocated space
  * Doubles the allocated size associated to a pointer array */
@@ -159,7 +254,7 @@ void * dictionary_realloc(void * ptr, int size,int bytes)
     }
     if(ptr!=NULL)
     {
-        memcpy(newptr+bytes*size, ptr, size*bytes);
+        memcpy((char *)newptr+bytes*size, ptr, size*bytes);
         free(ptr);
     }
 
@@ -698,6 +793,29 @@ HASH_t dictionary_hash(const char * cp)
 
     return hashk ;
 }
+
+/*--------------------------------------------------------------------------*/
+/**
+  @brief    dictionary_hash() of the first len bytes of key, which need
+            not be NUL terminated.
+ */
+/*--------------------------------------------------------------------------*/
+HASH_t dictionary_hashn(const char * cp, size_t len)
+{
+    HASH_t  hashk = 0 ;
+
+    while(len-- != 0)
+    {
+        hashk += *cp++;
+        hashk += (hashk<<10);
+        hashk ^= (hashk>>6) ;
+    }
+    hashk += (hashk <<3);
+    hashk ^= (hashk >>11);
+    hashk += (hashk <<15);
+
+    return hashk ;
+}
 #ifdef WANT_DICTIONARY_META
 /*--------------------------------------------------------------------------*/
 /**
@@ -781,24 +899,14 @@ dictionary * dictionary_new(unsigned size,const char *filename)
  */
 void dictionary_del(dictionary ** vd)
 {
-    int     i ;
     dictionary *d=*vd;
     if (d==NULL)
         return ;
-    for (i=0 ; i<=d->size ; i++)
-    {
-        if(d->hash[i]!=0)
-        {
-            if (d->key[i])
-                free(d->key[i]);
-            if (d->val[i])
-                free(d->val[i]);
-        }
-    }
-    free(d->val);
+    free(d->val);            /* the strings are interned, not owned */
     free(d->key);
     free(d->hash);
     free(d->skeys);
+    dictionary_bloom(d,0);
     if(d->filename!=NULL)
         free(d->filename);
     free(d);
@@ -824,8 +932,16 @@ char * dictionary_get(const dictionary * d, const char * key, char * defmsg)
 {
     int         i ;
     HASH_t     hashu;
+
+    if (d!=NULL && d->bloom!=NULL && !bloom_maybe(d->bloom,key,strlen(key)))
+        return (defmsg);                /* not there, one cache line read */
     hashu=dictionary_hash(key);
     i=dictionary_binsearch(d,hashu);
+    if (i<0 || d->key[i]==NULL || (key!=d->key[i] && strcmp(key,d->key[i])))
+    {
+        if (d!=NULL && d->bloom!=NULL)
+            BLOOM_COUNT(d->bloom,falsepos);
+    }
     if (i<0)
     {
         i=-i;
@@ -839,13 +955,112 @@ char * dictionary_get(const dictionary * d, const char * key, char * defmsg)
     }
     if( d->key[i]!=NULL)
     {
-        if(  !strcmp(key,d->key[i]))
+        if( key==d->key[i] || !strcmp(key,d->key[i]))   /* interned key: same pointer */
             return (d->val[i]);
         
     }
     return defmsg;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Build the Bloom filter of d from its keys, replacing any
+            earlier one; the statistics are kept.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_bloom(dictionary *d, unsigned bitsperkey)
+{
+    struct _dictbloom_ *b;
+    size_t bytes;
+    int    i;
+
+    if(d==NULL)
+        return -1;
+    b=d->bloom;
+    if(bitsperkey==0)
+    {
+        if(b!=NULL)
+            free(b->bits);
+        free(b);
+        d->bloom=NULL;
+        return 0;
+    }
+    if(b==NULL && (b=calloc(1,sizeof(*b)))==NULL)
+        return -1;
+    free(b->bits);
+    b->bitsperkey=bitsperkey;
+    b->k=(bitsperkey*693+500)/1000;     /* ln 2 bits per key */
+    if(b->k<1)
+        b->k=1;
+    if(b->k>16)
+        b->k=16;
+    b->cap= d->n>64 ? d->n : 64;
+    b->nblocks=((uint64_t)b->cap*bitsperkey+BLOOM_BLOCK-1)/BLOOM_BLOCK;
+    bytes=(size_t)b->nblocks*(BLOOM_BLOCK/8);
+    b->bits=aligned_alloc(64,bytes);
+    if(b->bits==NULL)
+    {
+        free(b);
+        d->bloom=NULL;
+        return -1;
+    }
+    memset(b->bits,0,bytes);
+    b->keys=0;
+    for(i=0;i<d->size;i++)
+        if(d->key[i]!=NULL)
+            bloom_set(b,d->key[i]);
+    d->bloom=b;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+int dictionary_bloomcount(dictionary *d, int on)
+{
+    if(d==NULL || d->bloom==NULL)
+        return -1;
+    d->bloom->counting= on!=0;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+int dictionary_bloomstats(const dictionary *d, FILE *f)
+{
+    const struct _dictbloom_ *b= d!=NULL ? d->bloom : NULL;
+    unsigned long misses;
+    int permille;
+
+    if(b==NULL || !b->counting)
+        return -1;
+    misses=b->rejected+b->falsepos;
+    permille= misses ? (int)(1000*b->falsepos/misses) : 0;
+    if(f!=NULL)
+        fprintf(f,"%s: bloom %u bits/key, k=%u, %u blocks, %d keys: %lu lookups, "
+                "%lu rejected, %lu false positives (%d.%d%% of misses)\n",
+                d->filename,b->bitsperkey,b->k,b->nblocks,b->keys,b->lookups,
+                b->rejected,b->falsepos,permille/10,permille%10);
+    return permille;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    dictionary_get() for a key given by pointer and length, as a
+            C++ string_view holds it. Nothing is copied.
+ */
+/*--------------------------------------------------------------------------*/
+char * dictionary_getn(const dictionary * d, const char * key, size_t len, char * defmsg)
+{
+    int         i ;
+
+    if (d!=NULL && d->bloom!=NULL && !bloom_maybe(d->bloom,key,len))
+        return (defmsg);
+    i=dictionary_binsearch(d,dictionary_hashn(key,len));
+    if( i>=0 && d->key[i]!=NULL && !strncmp(key,d->key[i],len) && d->key[i][len]=='\0')
+        return (d->val[i]);
+    if (d!=NULL && d->bloom!=NULL)
+        BLOOM_COUNT(d->bloom,falsepos);
+    return defmsg;
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Set a value into a dictionary.
@@ -906,24 +1121,17 @@ dictionary_set(dictionary * d, const char * key, const char * val)
         debug("hash=%10.8X,d->hash[i]=%10.8X, d->hash[i+1]=%10.8X,at i=%d\n",
               hashk,d->hash[i],d->hash[i+1],i);
         cpdk=d->key[i];
-        if ( 0==strcmp(key, cpdk) )    /* Same key */
+        if ( cpdk!=NULL && (key==cpdk || 0==strcmp(key, cpdk)) )   /* Same key, not the 0xffff end row */
         {
             /* Found a valid same key value: modify and return */
-            /* if new value fits in space reserved for old,
-             * overwrite old space and exit. No need to redo
-             * key hash, sort or free()/strdup
+            /* The value bytes may be shared with other rows and
+             * dictionaries, so the pointer is swapped for the
+             * interned new value. No need to redo key hash or sort.
              */
-            cpdv=d->val[i];
-            if (cpdv != NULL)
-            {
-                if ( strlen(val) > strlen(cpdv) )
-                {
-                    free(cpdv);
-                    d->val[i]= cpdv = strdup(val) ;
-                }
-                else
-                    strcpy(cpdv,val);
-            }
+            cpdv= (val!=NULL) ? (char *)intern(val) : NULL;
+            if (val!=NULL && cpdv==NULL)
+                return -1;
+            d->val[i]=cpdv;
             /* Value has been modified: return */
             d->info=i;
         }
@@ -959,6 +1167,12 @@ dictionary_set(dictionary * d, const char * key, const char * val)
         exit(0);
     }
 
+    /* interned before rows move, there is nothing to undo on failure */
+    cpdk= (char *)intern(key);
+    cpdv= (val!=NULL) ? (char *)intern(val) : NULL;
+    if (cpdk==NULL || (val!=NULL && cpdv==NULL))
+        return -1;
+
     /* does dict need expanding ? */
     if( d->n == d->size )
         if (dictionary_grow(d))
@@ -991,12 +1205,13 @@ dictionary_set(dictionary * d, const char * key, const char * val)
         j=i-1;
 doInsert:
         d->hash[j] = hashk;
-        d->key[j]  = strdup(key);
-        d->val[j]  = (val!=NULL) ? strdup(val) : NULL;
+        d->key[j]  = cpdk;
+        d->val[j]  = cpdv;
         debug("After\n");
         d->info = j;
         d->n++;
         d->lower--;
+        bloom_add(d,key);
         return 0;
     }
 
@@ -1085,18 +1300,7 @@ int dictionary_unset(dictionary * d, const char * key)
         return i;
     }
     /*shifting the table up with leading zeros */
-    /* after  first freeing  allocated memory  **/
-    if(d->hash[i])
-    {
-        if(d->key[i])
-        {
-            free(d->key[i]);
-         }
-        if(d->val[i])
-        {
-            free(d->val[i]);
-        }
-    }
+    /* the key and value stay in the intern table **/
     /* UNRAVELLING THE SHUFFLE UPWARDS IS FASTER THAN MERGING THE SHUFFLE      */
     /* UNRAVELLING THE SHUFFLE UPWARDS IS FASTER THAN MERGING THE SHUFFLE      */
     /* UNRAVELLING THE SHUFFLE UPWARDS IS FASTER THAN MERGING THE SHUFFLE      */
@@ -55,6 +55,9 @@
 //#define WANT_DICTIONARY_META
 //#define WANT_DICTIONARY_SHOW
 #define restrict
+#ifdef __cplusplus
+extern "C" {
+#endif
 /* define NDEBUG to obtain debug info  */
 #ifndef NDEBUG
     #define debug(M, ...)
@@ -103,9 +106,14 @@ typedef unsigned short  HASH_t;       /* 32 bit                    */
       lower             next available entry available to store a field in the table
                         or -1, to indicate the table should be resorted.
       val		column in the table that points to strings
-      key		column in the pointer that points to keys
+      key		column in the pointer that points to keys. Keys
+                        and values are interned (intern.h): shared with
+                        other rows and dictionaries, never written to.
       hash		a column of unsigned hash integers corresponding
                         to related key
+      bloom             optional blocked Bloom filter of the keys, see
+                        dictionary_bloom(). Lookups of absent keys stop
+                        there most of the time.
       skeys             skey[0] has count of entries between skey[1]...
                         skey[1]... has hash values of [sections]. This
                         field is completed for iniparser stuff. Otherwise it
@@ -128,6 +136,7 @@ typedef struct _dictionary_
     char        **   val ;  /** List of string values                       */
     HASH_t      *   hash ;  /** List of hash values for keys                */
     HASH_t 	*  skeys ;  /** skey[0] has number of sections in dict	    */
+    struct _dictbloom_ *bloom ; /** Bloom filter of the keys, or NULL	    */
 } dictionary ;
 
 /**
@@ -154,7 +163,7 @@ enum _printctl_
     clearflag=  1<<12,
     dumpflag=   1<<13
 
-} PRINTCTL;
+};
 
 /*---------------------------------------------------------------------------
                             Function prototypes
@@ -213,6 +222,46 @@ int dictionary_getbool(const dictionary *d,const char *key,const int defalt);
 
 HASH_t dictionary_hash(const char * key);
 
+/**
+ * @brief dictionary_hashn  dictionary_hash() of the first len bytes of key
+ */
+HASH_t dictionary_hashn(const char * key, size_t len);
+
+/**
+ * @brief dictionary_bloom  Put a blocked Bloom filter in front of the
+ *                          lookups of d. Each key sets its bits in one
+ *                          64 byte block, so a lookup of an absent key
+ *                          is rejected with one cache line most of the
+ *                          time, before the binary search. Keys set later
+ *                          are added; the filter is rebuilt larger when
+ *                          they double. Keys unset stay in the filter.
+ * @param d                 the dictionary
+ * @param bitsperkey        filter bits per key, 10 gives about 1% false
+ *                          positives; 0 removes the filter
+ * @return                  0 if Ok, -1 if out of memory
+ */
+int dictionary_bloom(dictionary *d, unsigned bitsperkey);
+
+/**
+ * @brief dictionary_bloomcount  Count lookups, rejects and false positives
+ *                               of the filter of d, for
+ *                               dictionary_bloomstats(). Off by default:
+ *                               the counters are relaxed atomics, still a
+ *                               write per lookup that concurrent readers
+ *                               of one dictionary contend on.
+ * @return                       0 if Ok, -1 without a filter
+ */
+int dictionary_bloomcount(dictionary *d, int on);
+
+/**
+ * @brief dictionary_bloomstats  One line of filter statistics on f:
+ *                               lookups, rejected, false positives
+ * @return                       false positives per thousand misses that
+ *                               reached the filter, -1 without a filter
+ *                               or without dictionary_bloomcount()
+ */
+int dictionary_bloomstats(const dictionary *d, FILE *f);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Create a new dictionary object.
@@ -255,6 +304,17 @@ void dictionary_del(dictionary ** vd);
 /*--------------------------------------------------------------------------*/
 char * dictionary_get(const dictionary * d, const char * key, char * def);
 
+/**
+ * @brief dictionary_getn  dictionary_get() with a key that is len bytes
+ *                         long and need not be NUL terminated
+ * @param d      the dictionary
+ * @param key    the first byte of the key
+ * @param len    its length
+ * @param def    returned if the key is not found
+ * @return       the value, or def
+ */
+char * dictionary_getn(const dictionary * d, const char * key, size_t len, char * def);
+
 /**
  * @brief dictionary_show  Show an row of the dictionary, using the row's index.
  * @param d      The dictionary
@@ -388,5 +448,8 @@ void dictionary_createsortedlist(dictionary *d);
 
 void dictionary_meta(dictionary *d, FILE *f);
 
+#ifdef __cplusplus
+}
+#endif
 /*--------------------------------------------------------------------------*/
 #endif
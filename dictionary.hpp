@@ -0,0 +1,220 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    dictionary.hpp
+   @author  Leslie Satenstein
+   @brief   C++17 handle over the dictionary, header only.
+
+   dict::Dictionary owns one dictionary * and frees it with
+   dictionary_del() when it goes out of scope. It can be moved, not
+   copied. Lookups take a std::string_view and go to dictionary_getn(),
+   so a key that is part of a larger buffer is looked up in place,
+   without a std::string or any other copy:
+
+       dict::Dictionary d(64,"uuid");
+       d.set("3f0e-21aa","sdb2");
+       if(auto dev=d.find(line.substr(5,9)))      // std::string_view
+           use(*dev);
+       int pass=d.get<int>("pass",0);             // parsed in place
+       for(auto [key,val] : d)                    // the rows in use
+           ...
+
+   get<T>() converts the value with dict::value_traits<T>, specialized
+   here for std::string_view, std::string, bool (as dictionary_getbool)
+   and the integer types (std::from_chars). Another type is supported
+   by specializing value_traits for it.
+
+   set() needs NUL terminated strings, as dictionary_set() does; the
+   string_view overload copies into a std::string for that. Iterators
+   are invalidated by set() and unset(), as the row pointers of the C
+   struct are. The views returned by find() and by an iterator point to
+   interned bytes (intern.h) and stay valid until intern_free(), after
+   the row is changed or the Dictionary is gone.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _DICTIONARY_HPP_
+#define _DICTIONARY_HPP_
+
+#include "dictionary.h"
+#include <charconv>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace dict
+{
+
+/*--------------------------------------------------------------------------*/
+/* value text to T, std::nullopt if it does not convert                    */
+template<class T, class Enable=void>
+struct value_traits;
+
+template<>
+struct value_traits<std::string_view>
+{
+    static std::optional<std::string_view> parse(std::string_view s) noexcept { return s; }
+};
+
+template<>
+struct value_traits<std::string>
+{
+    static std::optional<std::string> parse(std::string_view s) { return std::string(s); }
+};
+
+template<>
+struct value_traits<bool>
+{
+    static std::optional<bool> parse(std::string_view s) noexcept
+    {
+        if(s.empty() || std::string_view("FfTtYy01").find(s.front())==std::string_view::npos)
+            return std::nullopt;
+        return std::string_view("TtYy1").find(s.front())!=std::string_view::npos;
+    }
+};
+
+template<class T>
+struct value_traits<T,std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T,bool>>>
+{
+    static std::optional<T> parse(std::string_view s) noexcept
+    {
+        T v{};
+        auto r=std::from_chars(s.data(),s.data()+s.size(),v);
+        if(r.ec!=std::errc() || r.ptr!=s.data()+s.size())
+            return std::nullopt;
+        return v;
+    }
+};
+
+/*--------------------------------------------------------------------------*/
+class Dictionary
+{
+public:
+    using entry=std::pair<std::string_view,std::string_view>;
+
+    /* the rows with a key, in table order */
+    class iterator
+    {
+    public:
+        using iterator_category=std::forward_iterator_tag;
+        using value_type=entry;
+        using difference_type=std::ptrdiff_t;
+        using pointer=void;
+        using reference=entry;
+
+        iterator(const dictionary *d, int i) noexcept : d_(d), i_(i) { skip(); }
+        entry operator*() const noexcept
+        {
+            return { d_->key[i_], d_->val[i_]!=nullptr ? d_->val[i_] : std::string_view() };
+        }
+        iterator &operator++() noexcept { i_++; skip(); return *this; }
+        iterator operator++(int) noexcept { iterator t=*this; ++*this; return t; }
+        bool operator==(const iterator &o) const noexcept { return i_==o.i_; }
+        bool operator!=(const iterator &o) const noexcept { return i_!=o.i_; }
+
+    private:
+        void skip() noexcept
+        {
+            while(d_!=nullptr && i_<d_->size && d_->key[i_]==nullptr)
+                i_++;
+        }
+        const dictionary *d_;
+        int i_;
+    };
+
+    explicit Dictionary(unsigned size=0, const char *name="")
+        : d_(dictionary_new(size,name))
+    {
+        if(d_==nullptr)
+            throw std::bad_alloc();
+    }
+    /* takes ownership of a dictionary made by the C code */
+    static Dictionary adopt(dictionary *d) noexcept { return Dictionary(d,adopt_tag()); }
+    ~Dictionary() { reset(); }
+
+    Dictionary(const Dictionary &)=delete;
+    Dictionary &operator=(const Dictionary &)=delete;
+    Dictionary(Dictionary &&o) noexcept : d_(std::exchange(o.d_,nullptr)) {}
+    Dictionary &operator=(Dictionary &&o) noexcept
+    {
+        if(this!=&o)
+        {
+            reset();
+            d_=std::exchange(o.d_,nullptr);
+        }
+        return *this;
+    }
+
+    dictionary *get() const noexcept { return d_; }
+    dictionary *release() noexcept { return std::exchange(d_,nullptr); }
+    void reset() noexcept
+    {
+        if(d_!=nullptr)
+            dictionary_del(&d_);
+    }
+    explicit operator bool() const noexcept { return d_!=nullptr; }
+
+    /* d->n counts the reserved row as well */
+    int size() const noexcept { return d_!=nullptr && d_->n>0 ? d_->n-1 : 0; }
+    bool empty() const noexcept { return size()==0; }
+    iterator begin() const noexcept { return iterator(d_,0); }
+    iterator end() const noexcept { return iterator(d_,d_!=nullptr ? d_->size : 0); }
+
+    /* the value of key, std::nullopt if absent or stored as NULL */
+    std::optional<std::string_view> find(std::string_view key) const noexcept
+    {
+        const char *v= d_!=nullptr ? dictionary_getn(d_,key.data(),key.size(),nullptr) : nullptr;
+
+        if(v==nullptr)
+            return std::nullopt;
+        return std::string_view(v);
+    }
+    bool contains(std::string_view key) const noexcept { return find(key).has_value(); }
+
+    template<class T>
+    std::optional<T> get(std::string_view key) const
+    {
+        auto v=find(key);
+
+        if(!v)
+            return std::nullopt;
+        return value_traits<T>::parse(*v);
+    }
+    template<class T>
+    T get(std::string_view key, T def) const
+    {
+        auto v=get<T>(key);
+
+        return v ? *v : def;
+    }
+
+    /* 0 if Ok, as dictionary_set() */
+    int set(const char *key, const char *val) noexcept { return dictionary_set(d_,key,val); }
+    int set(const std::string &key, const std::string &val) noexcept
+    {
+        return dictionary_set(d_,key.c_str(),val.c_str());
+    }
+    int set(std::string_view key, std::string_view val)
+    {
+        return set(std::string(key),std::string(val));
+    }
+    int unset(const char *key) noexcept { return dictionary_unset(d_,key); }
+    int unset(const std::string &key) noexcept { return dictionary_unset(d_,key.c_str()); }
+
+private:
+    struct adopt_tag {};
+    Dictionary(dictionary *d, adopt_tag) noexcept : d_(d) {}
+
+    dictionary *d_;
+};
+
+} /* namespace dict */
+
+#endif
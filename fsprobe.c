@@ -0,0 +1,151 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    fsprobe.c
+   @author  Leslie Satenstein
+   @brief   Superblock probing (see fsprobe.h)
+
+   Superblock fields used, as offsets from the start of the filesystem
+   ext2/3/4  1024+56 magic 0xEF53, 1024+92 compat, 1024+96 incompat,
+             1024+104 uuid, 1024+120 label[16]
+   xfs       0 "XFSB", 32 uuid, 108 label[12]
+   vfat      54 "FAT" (or 82 "FAT32"), 39 (67) serial, 43 (71) label[11]
+   ntfs      3 "NTFS    ", 72 serial (64 bit)
+   swap      4086 "SWAPSPACE2", 1024+12 uuid, 1024+28 label[16]
+   btrfs     65536+64 "_BHRfS_M", 65536+32 fsid, 65536+136 num_devices,
+             65536+201 dev_item.devid, 65536+299 label[256]
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "fsprobe.h"
+
+#define PROBE_HEAD  8192
+#define BTRFS_SB    65536
+
+/*--------------------------------------------------------------------------*/
+static inline uint32_t le32(const unsigned char *p)
+{
+    return p[0] | p[1]<<8 | p[2]<<16 | (uint32_t)p[3]<<24;
+}
+static inline uint64_t le64(const unsigned char *p)
+{
+    return le32(p) | (uint64_t)le32(p+4)<<32;
+}
+
+static void uuid_fmt(const unsigned char *u, char *out)
+{
+    sprintf(out,"%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+            u[0],u[1],u[2],u[3],u[4],u[5],u[6],u[7],
+            u[8],u[9],u[10],u[11],u[12],u[13],u[14],u[15]);
+}
+
+/* copy a fixed width, possibly blank padded label */
+static void label_fmt(const unsigned char *p, size_t len, char *out)
+{
+    memcpy(out,p,len);
+    out[len]='\0';
+    while(len>0 && (out[len-1]==' ' || out[len-1]=='\0'))
+        out[--len]='\0';
+}
+
+/*--------------------------------------------------------------------------*/
+static int probe_ext(const unsigned char *b, struct fsprobe *fp)
+{
+    const unsigned char *sb=b+1024;
+
+    if(sb[56]!=0x53 || sb[57]!=0xEF)
+        return 0;
+    if(le32(sb+96) & (0x40|0x80|0x200))         /* extents, 64bit, flex_bg */
+        strcpy(fp->type,"ext4");
+    else if(le32(sb+92) & 0x4)                  /* has_journal */
+        strcpy(fp->type,"ext3");
+    else
+        strcpy(fp->type,"ext2");
+    uuid_fmt(sb+104,fp->uuid);
+    label_fmt(sb+120,16,fp->label);
+    return 1;
+}
+
+static int probe_xfs(const unsigned char *b, struct fsprobe *fp)
+{
+    if(memcmp(b,"XFSB",4))
+        return 0;
+    strcpy(fp->type,"xfs");
+    uuid_fmt(b+32,fp->uuid);
+    label_fmt(b+108,12,fp->label);
+    return 1;
+}
+
+static int probe_vfat(const unsigned char *b, struct fsprobe *fp)
+{
+    const unsigned char *bs;
+
+    if(b[510]!=0x55 || b[511]!=0xAA)
+        return 0;
+    if(!memcmp(b+82,"FAT32",5))
+        bs=b+67;
+    else if(!memcmp(b+54,"FAT",3))
+        bs=b+39;
+    else
+        return 0;
+    strcpy(fp->type,"vfat");
+    sprintf(fp->uuid,"%04X-%04X",le32(bs)>>16,le32(bs)&0xFFFF);
+    label_fmt(bs+4,11,fp->label);
+    if(!strcmp(fp->label,"NO NAME"))
+        *fp->label='\0';
+    return 1;
+}
+
+static int probe_ntfs(const unsigned char *b, struct fsprobe *fp)
+{
+    if(memcmp(b+3,"NTFS    ",8))
+        return 0;
+    strcpy(fp->type,"ntfs");
+    sprintf(fp->uuid,"%08X%08X",le32(b+76),le32(b+72));
+    return 1;
+}
+
+static int probe_swap(const unsigned char *b, struct fsprobe *fp)
+{
+    if(memcmp(b+4096-10,"SWAPSPACE2",10))
+        return 0;
+    strcpy(fp->type,"swap");
+    uuid_fmt(b+1024+12,fp->uuid);
+    label_fmt(b+1024+28,16,fp->label);
+    return 1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief fsprobe_read  Identify the filesystem at offset of fd
+ */
+/*--------------------------------------------------------------------------*/
+int fsprobe_read(int fd, uint64_t offset, uint64_t size, struct fsprobe *fp)
+{
+    unsigned char b[PROBE_HEAD];
+    unsigned char *sb=b;
+    ssize_t got;
+
+    memset(fp,0,sizeof(*fp));
+    memset(b,0,sizeof(b));
+    got=pread(fd,b,sizeof(b),offset);
+    if(got<0)
+        return -1;
+    if(probe_ext(b,fp) || probe_xfs(b,fp) || probe_vfat(b,fp)
+       || probe_ntfs(b,fp) || probe_swap(b,fp))
+        return 1;
+
+    if(size!=0 && size<BTRFS_SB+4096)
+        return 0;
+    got=pread(fd,sb,4096,offset+BTRFS_SB);
+    if(got<4096 || memcmp(sb+64,"_BHRfS_M",8))
+        return 0;
+    strcpy(fp->type,"btrfs");
+    uuid_fmt(sb+32,fp->uuid);
+    label_fmt(sb+299,sizeof(fp->label)-8,fp->label);
+    fp->ndevices=le64(sb+136);
+    fp->devid=le64(sb+201);
+    return 1;
+}
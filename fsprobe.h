@@ -0,0 +1,44 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    fsprobe.h
+   @author  Leslie Satenstein
+   @brief   Identify a filesystem from its superblock.
+
+   fsprobe_read() reads the superblock of a filesystem found at a byte
+   offset of an open file (a partition inside a raw disk image, or a
+   block device) and returns its type, UUID and label formatted the way
+   blkid and /dev/disk/by-* present them. One pread() of the first
+   8 KiB covers ext2/3/4, xfs, vfat, ntfs and swap; btrfs needs a second
+   read at 64 KiB.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _FSPROBE_H_
+#define _FSPROBE_H_
+
+#include "dictionary.h"
+
+struct fsprobe
+{
+    char type[16];              /** ext4, xfs, vfat, ntfs, swap, btrfs     */
+    char uuid[40];              /** as in /dev/disk/by-uuid                */
+    char label[264];            /** as in /dev/disk/by-label, may be empty */
+    uint64_t devid;             /** btrfs: this member's dev_item devid    */
+    uint64_t ndevices;          /** btrfs: number of member devices        */
+};
+
+/**
+ * @brief fsprobe_read  Identify the filesystem at offset of fd
+ * @param fd            file descriptor open for reading
+ * @param offset        byte offset of the filesystem
+ * @param size          byte length available, 0 if unknown
+ * @param fp            result
+ * @return              1 if recognized, 0 if not, -1 on read error
+ */
+int fsprobe_read(int fd, uint64_t offset, uint64_t size, struct fsprobe *fp);
+
+#endif
@@ -0,0 +1,212 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    fsspec.c
+   @author  Leslie Satenstein
+   @brief   fstab source spec resolver (see fsspec.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "fsspec.h"
+#include "intern.h"
+#include "multipath.h"
+#include "sysroot.h"
+#include "uuid.h"
+
+/* one row per namespace, indexed by enum fsspec_kind */
+static const struct
+{
+    const char   *tag;
+    unsigned char len;
+    unsigned char keeptag;      /* the dictionary key includes the tag */
+    const char   *notfound;
+} ns[SPEC_KINDS]=
+{
+    [SPEC_OTHER]     ={ "",           0,  0, NULL         },
+    [SPEC_UUID]      ={ "UUID=",      5,  0, "*not found" },
+    [SPEC_LABEL]     ={ "LABEL=",     6,  0, "not found"  },
+    [SPEC_PARTUUID]  ={ "PARTUUID=",  9,  1, "not found"  },
+    [SPEC_PARTLABEL] ={ "PARTLABEL=", 10, 1, "not found"  },
+    [SPEC_ID]        ={ "ID=",        3,  1, "not found"  },
+    [SPEC_PATH]      ={ "",           0,  1, NULL         },
+};
+
+/* /dev/disk/<dir>/name is the same as TAG=name */
+static const struct
+{
+    const char   *dir;
+    unsigned char len;
+    unsigned char kind;
+} bydir[]=
+{
+    { "by-uuid/",      8,  SPEC_UUID      },
+    { "by-label/",     9,  SPEC_LABEL     },
+    { "by-partuuid/",  12, SPEC_PARTUUID  },
+    { "by-partlabel/", 13, SPEC_PARTLABEL },
+    { "by-id/",        6,  SPEC_ID        },
+};
+
+/*--------------------------------------------------------------------------*/
+static int classify(const char *s)
+{
+    switch(*s)
+    {
+    case 'U':
+        return memcmp(s,"UUID=",5) ? SPEC_OTHER : SPEC_UUID;
+    case 'L':
+        return memcmp(s,"LABEL=",6) ? SPEC_OTHER : SPEC_LABEL;
+    case 'P':
+        if(!memcmp(s,"PARTUUID=",9))
+            return SPEC_PARTUUID;
+        return memcmp(s,"PARTLABEL=",10) ? SPEC_OTHER : SPEC_PARTLABEL;
+    case 'I':
+        return memcmp(s,"ID=",3) ? SPEC_OTHER : SPEC_ID;
+    case '/':
+        return SPEC_PATH;
+    default:
+        return SPEC_OTHER;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+static void unquote(char *s)
+{
+    size_t len=strlen(s);
+
+    if(len>=2 && *s=='"' && s[len-1]=='"')
+    {
+        memmove(s,s+1,len-2);
+        s[len-2]='\0';
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief fsspec_decode  \040 (fstab) and \x20 (udev) escapes, in place
+ */
+/*--------------------------------------------------------------------------*/
+char *fsspec_decode(char *s)
+{
+    char *in,*out;
+    unsigned c;
+    int  n;
+
+    for(in=out=s; *in!='\0'; )
+    {
+        if(*in=='\\' && in[1]>='0' && in[1]<='3' && in[2]>='0' && in[2]<='7' && in[3]>='0' && in[3]<='7')
+        {
+            *out++=(in[1]-'0')<<6 | (in[2]-'0')<<3 | (in[3]-'0');
+            in+=4;
+        }
+        else if(*in=='\\' && in[1]=='x' && sscanf(in+2,"%2x%n",&c,&n)==1 && n==2)
+        {
+            *out++=c;
+            in+=4;
+        }
+        else
+            *out++=*in++;
+    }
+    *out='\0';
+    return s;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief fsspec_parse  One switch to classify, then the namespace row
+ */
+/*--------------------------------------------------------------------------*/
+int fsspec_parse(const char *spec, struct fsspec *fs)
+{
+    char   canon[UUID_STRLEN+1];
+    char  *val;
+    const char *is;
+    size_t i;
+    int    kind;
+
+    fs->kind=SPEC_OTHER;
+    fs->known=0;
+    fs->key=fs->buf;
+    fs->notfound=NULL;
+    snprintf(fs->buf,sizeof(fs->buf),"%s",spec);
+    unquote(fs->buf);                   /* "UUID=xxx" */
+    kind=classify(fs->buf);
+    if(kind==SPEC_OTHER)
+        return SPEC_OTHER;
+
+    /* /dev/disk/by-uuid/xxx is rewritten UUID=xxx, the tag is shorter */
+    if(kind==SPEC_PATH && !memcmp(fs->buf,"/dev/disk/",10))
+        for(i=0;i<sizeof(bydir)/sizeof(bydir[0]);i++)
+            if(!memcmp(fs->buf+10,bydir[i].dir,bydir[i].len))
+            {
+                kind=bydir[i].kind;
+                val=fs->buf+10+bydir[i].len;
+                memmove(fs->buf+ns[kind].len,val,strlen(val)+1);
+                memcpy(fs->buf,ns[kind].tag,ns[kind].len);
+                break;
+            }
+
+    val=fs->buf+ns[kind].len;
+    unquote(val);                       /* LABEL="xxx" */
+    fsspec_decode(val);
+    if(kind<=SPEC_PARTUUID && uuid_canon(val,canon))
+        strcpy(val,canon);              /* as multipath_set() stores it */
+    fs->kind=kind;
+    fs->key= ns[kind].keeptag ? fs->buf : val;
+    /* never interned: no dictionary holds it. Otherwise the interned */
+    /* copy, which a dictionary row holding it matches on the pointer */
+    is=intern_find(fs->key,strlen(fs->key));
+    fs->known= is!=NULL;
+    if(is!=NULL)
+        fs->key=is;
+    fs->notfound=ns[kind].notfound;
+    return kind;
+}
+
+/*-------------------------------------------------------------------------*/
+char *fsspec_get(const dictionary *d, const struct fsspec *fs, char *def)
+{
+    return fs->known ? dictionary_get(d,fs->key,def) : def;
+}
+
+/*--------------------------------------------------------------------------*/
+struct linkarg
+{
+    dictionary *d;
+    const char *tag;
+    int         refused;
+};
+
+static int link_cb(const char *name, const char *target, void *varg)
+{
+    struct linkarg *la=varg;
+    char key[PATH_MAX+16];
+    const char *dev;
+
+    snprintf(key,sizeof(key),"%s%s",la->tag,name);
+    fsspec_decode(key);
+    dev=strrchr(target,'/');
+    dev= dev ? dev+1 : target;
+    debug("key=[%s] dev=[%s]\n",key,dev);
+    if(multipath_set(la->d,key,dev))
+        la->refused++;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief fsspec_links  /dev/disk/by-xxx links as dictionary keys
+ */
+/*--------------------------------------------------------------------------*/
+int fsspec_links(dictionary *d, const char *dir, const char *tag)
+{
+    struct linkarg la;
+
+    la.d=d;
+    la.tag=tag;
+    la.refused=0;
+    if(sysroot_links(dir,link_cb,&la)<0)
+        return -1;
+    return la.refused;
+}
@@ -0,0 +1,91 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    fsspec.h
+   @author  Leslie Satenstein
+   @brief   Classify the first field of an fstab line and turn it into the
+            dictionary key of its namespace.
+
+   One switch on the leading bytes picks the row of a small table, which
+   gives the tag to strip, whether the dictionary key keeps the tag, and
+   the text printed when the key is not found:
+       UUID=xxx                  key xxx
+       LABEL=xxx                 key xxx
+       PARTUUID=xxx              key PARTUUID=xxx
+       PARTLABEL=xxx             key PARTLABEL=xxx
+       ID=xxx                    key ID=xxx             (/dev/disk/by-id)
+       /dev/disk/by-uuid/xxx     as UUID=xxx, and the same for by-label,
+                                 by-partuuid, by-partlabel and by-id
+       /other/path               key /other/path        (loopdev.h)
+   Quotes around the spec or its value are dropped, fstab octal escapes
+   (\040) are decoded, and so are the \x20 escapes udev uses in the
+   by-label link names, so both sides meet on the plain text. A UUID,
+   LABEL or PARTUUID value shaped like a UUID is put in the canonical
+   form of uuid.h, as the discovery side stores it. A key that was ever
+   interned (intern.h) is replaced by its interned copy, which a
+   dictionary row holding it matches on the pointer; a key that never was
+   is held by no dictionary, and fsspec_get() answers without a lookup.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _FSSPEC_H_
+#define _FSSPEC_H_
+
+#include "dictionary.h"
+#include <limits.h>
+
+enum fsspec_kind
+{
+    SPEC_OTHER,                 /** comment, blank or unknown, printed as is */
+    SPEC_UUID,
+    SPEC_LABEL,
+    SPEC_PARTUUID,
+    SPEC_PARTLABEL,
+    SPEC_ID,
+    SPEC_PATH,                  /** file backed source, see loopdev.h */
+    SPEC_KINDS
+};
+
+struct fsspec
+{
+    int         kind;           /** enum fsspec_kind                     */
+    const char *key;            /** the dictionary key                   */
+    int         known;          /** key is interned, see fsspec_get()    */
+    const char *notfound;       /** shown when the key is not found      */
+    char        buf[PATH_MAX+16];
+};
+
+/**
+ * @brief fsspec_parse  Classify spec and build its key
+ * @param spec          first field of an fstab line
+ * @param fs            result
+ * @return              fs->kind
+ */
+int fsspec_parse(const char *spec, struct fsspec *fs);
+
+/**
+ * @brief fsspec_get  dictionary_get() of fs->key, def at once when the key
+ *                    was never interned
+ */
+char *fsspec_get(const dictionary *d, const struct fsspec *fs, char *def);
+
+/**
+ * @brief fsspec_decode  Decode \ooo and \xhh escapes in place
+ * @return               s
+ */
+char *fsspec_decode(char *s);
+
+/**
+ * @brief fsspec_links  Key every link of a /dev/disk/by-xxx directory
+ * @param d             the dictionary
+ * @param dir           /dev/disk/by-uuid, read under --root
+ * @param tag           prefix of the keys, "" or "ID="
+ * @return              number of links the dictionary refused, -1 if dir
+ *                      can not be read
+ */
+int fsspec_links(dictionary *d, const char *dir, const char *tag);
+
+#endif
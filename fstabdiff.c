@@ -0,0 +1,211 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    fstabdiff.c
+   @author  Leslie Satenstein
+   @brief   Semantic fstab diff (see fstabdiff.h)
+
+   The hash tables are chained through arrays of entry numbers, sized to
+   the next power of two above twice the number of old entries, so each
+   lookup is a short walk. An old entry used by a match or a move is
+   marked and is not reported as removed.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "fstabdiff.h"
+#include "mounttab.h"
+#include "fsspec.h"
+#include "mntopt.h"
+#include "intern.h"
+
+struct join
+{
+    int     *head;                      /* bucket to first entry, -1 if none */
+    int     *next;                      /* entry to next entry in its bucket */
+    unsigned mask;
+};
+
+/*--------------------------------------------------------------------------*/
+static unsigned str_hash(const char *s)
+{
+    return intern_hash(s,strlen(s));
+}
+
+static void join_new(struct join *j, int n)
+{
+    unsigned size=16;
+
+    while(size<2u*n)
+        size<<=1;
+    j->mask=size-1;
+    j->head=malloc(size*sizeof(int));
+    j->next=malloc((n+1)*sizeof(int));
+    if(j->head==NULL || j->next==NULL)
+        exit(-1);
+    memset(j->head,-1,size*sizeof(int));
+}
+
+static void join_add(struct join *j, const char *key, int i)
+{
+    unsigned b=str_hash(key)&j->mask;
+
+    j->next[i]=j->head[b];
+    j->head[b]=i;
+}
+
+static void join_del(struct join *j)
+{
+    free(j->head);
+    free(j->next);
+}
+
+/*--------------------------------------------------------------------------*/
+/* the join key of the device of e: sdb1, or the spec key for tmpfs, nfs   */
+static const char *dev_key(const struct mountent *e, struct fsspec *fs)
+{
+    if(*e->dev)
+        return e->dev;
+    fsspec_parse(e->spec,fs);
+    return fs->kind==SPEC_OTHER ? e->spec : fs->key;
+}
+
+/* the unused old entry of mountpoint where                               */
+static int join_mount(const struct join *j, const mounttab *mt, const char *used,
+                      const char *where)
+{
+    int i;
+
+    for(i=j->head[str_hash(where)&j->mask]; i>=0; i=j->next[i])
+        if(!used[i] && !strcmp(where,mt->ent[i].where))
+            return i;
+    return -1;
+}
+
+/* an unused old entry on the device of e whose mountpoint is gone in nm   */
+static int join_moved(const struct join *j, const mounttab *om, const char *used,
+                      const mounttab *nm, const struct mountent *e)
+{
+    struct fsspec fs,fs2;
+    const struct mountent *o;
+    const char *key;
+    int i,k;
+
+    key=dev_key(e,&fs);
+    for(i=j->head[str_hash(key)&j->mask]; i>=0; i=j->next[i])
+    {
+        o=&om->ent[i];
+        if(used[i] || strcmp(key,dev_key(o,&fs2)) || (!*o->where)!=(!*e->where))
+            continue;
+        if(*o->where)
+        {
+            k=pathtrie_lpm(nm->trie,o->where,0);
+            if(k>=0 && !strcmp(nm->ent[k].where,o->where))
+                continue;               /* still mounted there */
+        }
+        return i;
+    }
+    return -1;
+}
+
+/*--------------------------------------------------------------------------*/
+static void change(FILE *f, const char *what, const struct mountent *e, const char *old,
+                   const char *new)
+{
+    fprintf(f,"%s\t%s\t%s\t%s\t%s\n",what,*e->where ? e->where : "swap",old,new,
+            *e->dev ? e->dev : "-");
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief fstabdiff_write  Build the tables on old, one pass over new,
+ *                         then the old entries nobody used
+ */
+/*--------------------------------------------------------------------------*/
+int fstabdiff_write(FILE *f, const dictionary *d, const char *oldfile, const char *newfile)
+{
+    struct fsspec fs,fs2;
+    struct join bymnt,bydev;
+    const struct mountent *o,*e;
+    mounttab *om,*nm;
+    char *used;
+    int   changes=0;
+    int   i,j;
+
+    om=mounttab_load(d,oldfile,MT_NOAUTO);
+    nm=mounttab_load(d,newfile,MT_NOAUTO);
+    if(om==NULL || nm==NULL)
+    {
+        mounttab_del(&om);
+        mounttab_del(&nm);
+        return -1;
+    }
+    join_new(&bymnt,om->n);
+    join_new(&bydev,om->n);
+    used=calloc(om->n+1,1);
+    if(used==NULL)
+        exit(-1);
+    for(i=om->n-1;i>=0;i--)             /* chains in file order */
+    {
+        o=&om->ent[i];
+        if(*o->where)
+            join_add(&bymnt,o->where,i);
+        join_add(&bydev,dev_key(o,&fs),i);
+    }
+
+    fprintf(f,"#change\tmount\told\tnew\tdevice\n");
+    for(j=0;j<nm->n;j++)
+    {
+        e=&nm->ent[j];
+        i= *e->where ? join_mount(&bymnt,om,used,e->where) : -1;
+        if(i<0)
+        {
+            i=join_moved(&bydev,om,used,nm,e);
+            if(i<0)
+            {
+                change(f,"add",e,"-",e->spec);
+                changes++;
+                continue;
+            }
+            used[i]=1;
+            if(*e->where)               /* a swap entry found its device */
+            {
+                change(f,"move",e,om->ent[i].where,e->where);
+                changes++;
+            }
+            continue;
+        }
+        used[i]=1;
+        o=&om->ent[i];
+        if(strcmp(dev_key(o,&fs),dev_key(e,&fs2)))
+        {
+            change(f,"device",e,dev_key(o,&fs),dev_key(e,&fs2));
+            changes++;
+        }
+        if(strcmp(o->type,e->type))
+        {
+            change(f,"type",e,o->type,e->type);
+            changes++;
+        }
+        if(mntopt_set(o->opts,o->type)!=mntopt_set(e->opts,e->type))
+        {
+            change(f,"options",e,o->opts,e->opts);
+            changes++;
+        }
+    }
+    for(i=0;i<om->n;i++)
+        if(!used[i])
+        {
+            change(f,"remove",&om->ent[i],om->ent[i].spec,"-");
+            changes++;
+        }
+
+    fprintf(stderr,"%d changes\n",changes);
+    join_del(&bymnt);
+    join_del(&bydev);
+    free(used);
+    mounttab_del(&om);
+    mounttab_del(&nm);
+    return changes;
+}
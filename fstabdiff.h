@@ -0,0 +1,45 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    fstabdiff.h
+   @author  Leslie Satenstein
+   @brief   What an fstab change does (--diff OLD NEW).
+
+   Both files are read with mounttab_load(), so every spec is resolved to
+   its device: LABEL=data and UUID=3f0e... on the same partition are the
+   same entry, and spacing does not matter. The old entries are put in
+   two hash tables, by mountpoint and by device; one pass over the new
+   entries then reports, tab separated,
+       #change  mount   old         new         device
+       add      /x      -           UUID=...    sdb1
+       remove   /y      LABEL=y     -           sdc1
+       move     /z      /old/z      /z          sdd1     same device
+       device   /w      sdb2        sdb3        sdb3
+       type     /w      ext4        xfs         sdb3
+       options  /w      defaults    noatime     sdb3     canonical sets
+   Options are compared as canonical sets (mntopt.h): order, repeated
+   options and what the kernel does anyway do not count, defaults and rw
+   are the same. Swap entries are joined by device, their mount column
+   reads swap.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _FSTABDIFF_H_
+#define _FSTABDIFF_H_
+
+#include "dictionary.h"
+
+/**
+ * @brief fstabdiff_write  Compare two fstabs
+ * @param f               output stream
+ * @param d               the dictionary, spec to device
+ * @param oldfile         the fstab before, read under --root
+ * @param newfile         the fstab after
+ * @return                number of changes, -1 if a file can not be read
+ */
+int fstabdiff_write(FILE *f, const dictionary *d, const char *oldfile, const char *newfile);
+
+#endif
@@ -53,6 +53,15 @@
 //#define NDEBUG                //enable if you want the debug macros, (they are in dictionary.h)
 
 #include "dictionary.h"
+#include "multipath.h"
+#include "parttable.h"
+#include "loopdev.h"
+#include "devtable.h"
+#include "btrfs.h"
+#include "sysattr.h"
+#include "sysroot.h"
+#include "fsspec.h"
+#include "intern.h"
 // commented #includes are first declared in dictionary.h
 //#include <stdio.h>
 //#include <string.h>
@@ -61,12 +70,14 @@
 #include <getopt.h>		//externals
 #include <fcntl.h>
 #include <sys/stat.h>           //chmod
+#include <sys/wait.h>
 #include <limits.h>
 #include <libgen.h>
 
 
 dictionary *ini;            //this is a data dictionary pointer. The DD will hold
 //the UUID value as key and the /dev value as data
+devtable *devs;            //device numbers (major:minor) to device names
 
 
 FILE *filein;
@@ -78,8 +89,20 @@ char buffer[PATH_MAX];
 struct stat statbuf;
 char pgm[257];
 char devdiskfile[32]  ="/tmp/uuid.uXXXXXX.txt";
+int  devdiskfd=-1;              /* from the one mkstemps() in main() */
+char annotemplate[256];         /* -t annotation template, see sysattr.h */
+char rootdir[PATH_MAX];         /* --root, fstab /dev /sys /proc are read under it */
+
+static const struct option longopts[]=
+{
+    { "root",    required_argument, NULL, 'r' },
+    { "sysroot", required_argument, NULL, 'r' },
+    { "help",    no_argument,       NULL, 'h' },
+    { NULL,      0,                 NULL,  0  }
+};
 const char nullchar='\0';
 static void fstabToDictMatch(FILE *);
+static char *devnote(const char *);
 int main(int ,char **);
 
 
@@ -117,6 +140,23 @@ char * strtrim(char * restrict in,int option)
 }
 
 
+/**
+ * @brief devnote  The annotation for the device found: /dev/sdq3, or the
+ *                 -t template expanded for it
+ * @param devid    device name, or the "not found" text
+ * @return         static buffer, valid until the next call
+ */
+static char *devnote(const char *devid)
+{
+    static char note[PATH_MAX];
+
+    if(*annotemplate==nullchar)
+        snprintf(note,sizeof(note),"/dev/%s",devid);
+    else
+        sysattr_format(annotemplate,"/dev/",devid,note,sizeof(note));
+    return note;
+}
+
 /**
  * @brief fstabToDictMatch
  *        This function matches each line of an fstab file to the
@@ -124,89 +164,69 @@ char * strtrim(char * restrict in,int option)
  *        and from /dev/disk/by-label.
  *        NOTE: NOTE:
  *        LABEL=sde1Spare /Development       ext4   defaults,noatime     1 2
+ *        The first field is classified once by fsspec_parse(), which
+ *        gives the key to look up, whatever the kind of spec.
  * @param f the stream to where the output is to be written.
  */
 static void fstabToDictMatch(FILE *f)
 {
+    struct fsspec fs;
     char *devid=NULL;
-    char defs[96];
+    char *note;
+    char defs[PATH_MAX];
     char dmpodr[40];
     char dmpodr2[40];
     char fstype[40];
-    char mnt_name[64];
-    char label[96];
-    char uuidln[50];
-    char workarea[256];
-
-
-    //FILE *fin;
+    char mnt_name[PATH_MAX];
+    char spec[PATH_MAX];
+    char workarea[PATH_MAX];
+    char btrfsnote[PATH_MAX];
     int i;
 
-    fin=fopen(fstab,"rb");
+    fin=sysroot_fopen(fstab);
     if(fin==NULL)
     {
         fprintf(stderr,"Can't open file \"%s\" for reading\n",fstab);
         exit(89);
     }
-    debug("reading %s\n",fstab);
     while(!feof(fin))
     {
         if(NULL== (fgets(buffer,sizeof(buffer),fin)))
             continue;
 
         strcpy(workarea,buffer);
+        workarea[sizeof(workarea)-1]=nullchar;
         strtrim(workarea,3);
-
-        /******************    LABEL LOGIC ***************************/
-        if(!memcmp(workarea,"LABEL=",6))
+        debug("Processing workarea=[%s]\n",workarea);
+        i=sscanf(workarea,"%4095s %4095s%39s%4095s%39s%39s",spec,mnt_name,fstype,defs,dmpodr,dmpodr2);
+        if(i!=6 || fsspec_parse(spec,&fs)==SPEC_OTHER)
+        {
+            fputs(buffer,f);            /* comments, blank lines, proc, tmpfs */
+            continue;
+        }
+        debug("looking up [%s] in dictionary\n",fs.key);
+        if(fs.kind==SPEC_PATH)
         {
-            i=sscanf(workarea,"%s %s%s%s%s%s",label,mnt_name,fstype,defs,dmpodr,dmpodr2);
-            debug("sscan rc = %d label=%s, mount_name=%s device_id=%s\n",i,label+6,mnt_name,devid);
-            if (i==6)
+            /* loop devices, swap files and image files, see filedev_fill() */
+            devid=fsspec_get(ini,&fs,NULL);
+            if(devid==NULL)
             {
-                //fprintf(stderr,"label=[%s] label+6=[%s]\n",label,label+6);
-                //fprintf(stderr,"label=%s hash=%10.8X\n",label+6,dictionary_hash(label+6));
-                //dictionary_rawdump(uuid,stderr);
-                devid =dictionary_get(ini,label+6,"not found");
-                fprintf(f,"%-42s %-25s %-7s %s\t%s %s #/dev/%s\n",label,mnt_name,fstype,defs,dmpodr,dmpodr2,devid);
+                fputs(buffer,f);
                 continue;
             }
+            note=devid;
         }
-
-        /******************************* END LABEL LOGIC ***********************/
-
-
-        if(memcmp(workarea,"UUID=",5))
+        else
         {
-            fputs(buffer,f);
-            continue;
+            devid=fsspec_get(ini,&fs,(char *)fs.notfound);
+            note=devnote(devid);
+            /* all members of a btrfs filesystem, and its subvolume */
+            if((fs.kind==SPEC_UUID || fs.kind==SPEC_LABEL) && !strcmp(fstype,"btrfs")
+               && btrfs_annotate(devid,defs,"/dev/",btrfsnote,sizeof(btrfsnote)))
+                note=btrfsnote;
         }
-        debug("Processing workarea=[%s]\n",workarea);
-        /*
-         *  sscanf( workarea, format, field of pointers )
-         * Interpret  [^ ]      as a field ending in a blank
-         * Interpret  [^' ']    as a field ending in a blank
-         * Interpret [^ |\t]    as a field ending in blank or tab char
-         * Interpret [^' '|\t]  as a field ending in blank or tab char
-         * Interpret [^ |\t\n]  as a field ending in blank, tabchar or end-of-line
-         *
-         */
-
-        i=sscanf(workarea,"%s%s%s%s%s%s",
-                 uuidln,mnt_name,fstype,defs,dmpodr,dmpodr2);
-        if(i!=6)
-        {
-            //fprintf(stderr,"I = %d\n",i);
-            fputs(buffer,f);
-            continue;
-        }
-        debug("looking up [%s] in dictionary\n",uuidln+5);
-        debug("This\n%s\n",buffer);
-
-        devid=dictionary_get(ini,uuidln+5,"*not found");
         debug("dictionary_get() returned [%s]\n",devid);
-        fprintf(f,"%-42s %-25s %-7s %s\t%s %s #/dev/%s\n",
-                uuidln,mnt_name,fstype,defs,dmpodr,dmpodr2,devid);
+        fprintf(f,"%-42s %-25s %-7s %s\t%s %s #%s\n",spec,mnt_name,fstype,defs,dmpodr,dmpodr2,note);
     }
     fclose(fin);
 }
@@ -241,6 +261,7 @@ static void Dictionary_fill_Entries(char *line)
         i=sscanf(work,"%s%s%s%s",device,protocol,uuidln,mount);
     else
         i=sscanf(work,"%s%s%s%s%s",device,protocol,label,uuidln,mount);
+    fsspec_decode(label);           /* lsblk writes blanks as \x20 */
 
     if(!strcmp("ntfs",protocol))
     {
@@ -257,18 +278,18 @@ static void Dictionary_fill_Entries(char *line)
                 strcpy(uuidln,mount);
                 *mount=nullchar;
                 debug("at protocol ntfs  case 2 dictionary_set(ini,%s,%s)\n",uuidln,device);
-                dictionary_set(ini,uuidln,device);
+                multipath_set(ini,uuidln,device);
             }
             break;
         case 3:				/* sda2  ntfs                   3C5A072D5A06E40C  */
             debug("at ntfs case 3 dictionary_set(ini,%s,%s)\n",uuidln,device);
-            dictionary_set(ini,uuidln,device);
+            multipath_set(ini,uuidln,device);
             break;
         case 4:
             debug("at ntfs case 4 label=%s  device=%s uuid=%s\n",label,device,uuidln);
             if ( *label!=nullchar)
-                dictionary_set(ini,label,device);
-            dictionary_set(ini,uuidln, device);
+                multipath_set(ini,label,device);
+            multipath_set(ini,uuidln, device);
             break;
         case 5:
             debug("at ntfs case 5 label=%s  device=%s uuid=%s\n",label,device,uuidln);
@@ -281,9 +302,9 @@ static void Dictionary_fill_Entries(char *line)
                     strcpy(uuidln,mount);
                     *mount=nullchar;
                     i--;
-                    dictionary_set(ini,label,device);
+                    multipath_set(ini,label,device);
                 }
-                dictionary_set(ini,uuidln,device);
+                multipath_set(ini,uuidln,device);
                 break;
             }
         default:
@@ -301,31 +322,34 @@ static void Dictionary_fill_Entries(char *line)
 
         case 2:
             debug("at protocol %s 2 dictionary_set(ini,%s,%s)\n",protocol, uuidln,device);
-            dictionary_set(ini,uuidln,device);
+            multipath_set(ini,uuidln,device);
             break;
 
         case 3:				/* sdc1  xfs                    2b2e8ae3-6339-4df1-8f06-e91a16f3e424 */
             debug("at protocol %s case 3 dictionary_set(ini,%s,%s)\n",protocol, uuidln,device);
-            dictionary_set(ini,uuidln,device);
+            multipath_set(ini,uuidln,device);
             break;
 
         case 4:          /* sdd8  swap   sdd8F24swap     5c02759a-da32-40e0-9e85-4cab6fb02c94 */
             debug("at protocol=%s case 4   uuidln=%s. device=%s label=%s\n",protocol,uuidln,device,label);
-            dictionary_set(ini,uuidln,device);
+            multipath_set(ini,uuidln,device);
             if (*label!=nullchar)
-                dictionary_set(ini,label,device);
+                multipath_set(ini,label,device);
             break;
 
         case 5:				/* sdb2  ext4   sdb2scratch     6e488205-8791-41c2-8043-5051f8d0b185 /scratch */
             debug("at protocol=%s case 5   uuidln=%s. device=%s label=%s\n",protocol,uuidln,device,label);
             if ( *label != nullchar)
-                dictionary_set(ini,label,device);
-            dictionary_set(ini,uuidln,device);
+                multipath_set(ini,label,device);
+            multipath_set(ini,uuidln,device);
 
         default:
             break;
         }
     }
+    /* every member of a multi-device btrfs carries the same UUID */
+    if(!strcmp("btrfs",protocol) && *uuidln!=nullchar)
+        btrfs_member_add(uuidln,device);
     if(i==100)
     {
         fprintf(stderr,"\n%s\n",work);
@@ -334,6 +358,40 @@ static void Dictionary_fill_Entries(char *line)
     return;
 }
 
+/**
+ * @brief run_lsblk  lsblk -f -l, with --sysroot under --root, its output
+ *                   written to fd. No shell: the root path is one argv
+ *                   entry, whatever quotes it holds.
+ * @return           exit status of lsblk, -1 if it could not be run
+ */
+static int run_lsblk(int fd)
+{
+    char *argv[]={ "lsblk", "-f", "-l", NULL, NULL, NULL };
+    pid_t pid;
+    int   status;
+
+    if(*rootdir!=nullchar)          /* lsblk reads /sys and /run/udev of the root */
+    {
+        argv[3]="--sysroot";
+        argv[4]=rootdir;
+    }
+    fflush(NULL);
+    pid=fork();
+    if(pid<0)
+        return -1;
+    if(pid==0)
+    {
+        if(dup2(fd,STDOUT_FILENO)<0)
+            _exit(127);
+        execv("/usr/bin/lsblk",argv);
+        _exit(127);
+    }
+    while(waitpid(pid,&status,0)<0)
+        if(errno!=EINTR)
+            return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
 /**
  * @brief create_dictionary
  *        Reading the ls -l /dev/disk/by-uuid/ image  Image similar to next line
@@ -350,10 +408,12 @@ static dictionary * create_dictionary(void)
     if(ini==NULL)
         exit(99);
 
-    close(mkstemps(devdiskfile,4));
-
-    sprintf(buffer,"/usr/bin/lsblk -f -l  >%s",devdiskfile);
-    system(buffer);
+    multipath_load();               /* paths to one LUN are stored once */
+    fsspec_links(ini,"/dev/disk/by-id","ID=");  /* ID= keys, best effort */
+    if(run_lsblk(devdiskfd))
+        fprintf(stderr,"/usr/bin/lsblk failed\n");
+    close(devdiskfd);
+    devdiskfd=-1;
 #ifdef NDEBUG
     sprintf(buffer,"cat %s",devdiskfile);
     system( buffer);
@@ -380,7 +440,14 @@ static dictionary * create_dictionary(void)
         Dictionary_fill_Entries(buffer);
     }
     fclose(filein);
+    btrfs_finish(ini);              /* one key, all members, lowest devid first */
     unlink(devdiskfile);
+    parttable_fill(ini);            /* PARTUUID= and PARTLABEL= keys */
+    loopdev_fill(ini);              /* loop device backing files */
+    devs=devtable_new();            /* major:minor -> device name */
+    devtable_load(devs);
+    filedev_fill(ini,devs,fstab);   /* /dev/loopN, swap and image file sources */
+    multipath_free();
 #ifdef NDEBUG
     fprintf(stderr,"dumping dictionary\n");
     debug("%s: showing meta info\n",__FUNCTION__);
@@ -400,11 +467,17 @@ static dictionary * create_dictionary(void)
 int main(int argc, char *argv[])
 {
     int c;
+    int fd;
     int err=0;
     *outfile=nullchar;
     fout=stdout;
     unlink("/tmp/uuid.*");
-    close(mkstemps(devdiskfile,4));
+    devdiskfd=mkstemps(devdiskfile,4);
+    if(devdiskfd<0)
+    {
+        fprintf(stderr,"Can't create %s: %s\n",devdiskfile,strerror(errno));
+        exit(1);
+    }
     debug("devdiskfile=%s\n",devdiskfile);
     if(!isatty(fileno(stdout)))
     {
@@ -413,7 +486,7 @@ int main(int argc, char *argv[])
        goto help;
     }
 
-    while(  (c=(getopt(argc,argv,"HhI:i:o:O:")))  !=-1 )
+    while(  (c=(getopt_long(argc,argv,"HhI:i:o:O:t:T:r:R:",longopts,NULL)))  !=-1 )
     {
         switch (c)
         {
@@ -434,27 +507,18 @@ help:
                            "adding a #/dev/xxxxx reference, where xxxx is obtained from the /dev/disk/by-uuid\n"
                            "or from /dev/disk/by-label.  This program written by Leslie Satenstein 25April 2016\n",pgm);
             fprintf(stderr,"If uncertain about %s's use, copy /etc/fstab to /tmp and try it out\n",pgm);
+            fprintf(stderr,"\n--root dir    read the fstab, /dev, /sys and /proc of a container root or a\n"
+                           "              captured tree, symlinks are resolved inside dir (also -r)\n");
+            fprintf(stderr,"-t template   annotation template, e.g. -t '%%d %%s %%r %%m' gives\n"
+                           "              #/dev/sdq3 3.6T HDD ST4000NM   (%%d device, %%n name,\n"
+                           "              %%s size, %%r HDD/SSD, %%m model, %%S serial)\n");
             err=1;
             break;
 
         case 'i':
         case 'I':
             if(strlen(optarg))
-            {
-                strcpy(fstab,optarg);
-                if(stat(fstab,&statbuf) ==-1)
-                {
-                    fprintf(stderr,"File %s not accessable.\n",fstab);
-                    err=1;
-                }
-                else
-                    if((statbuf.st_mode & S_IFMT)!=S_IFREG)
-                    {
-                        fprintf(stderr,"File %s is not a regular file\n",fstab);
-                        err=1;
-                    }
-
-            }
+                strcpy(fstab,optarg);   /* checked below, under --root */
             else
             {
                 fprintf(stderr,"-i needs a path/filename\n");
@@ -470,21 +534,55 @@ help:
             }
             strcpy(outfile,optarg);
             break;
+        case 't':
+        case 'T':
+            snprintf(annotemplate,sizeof(annotemplate),"%s",optarg);
+            break;
+        case 'r':
+        case 'R':
+            strcpy(rootdir,optarg);
+            break;
         default:
             break;
         }
     }
+    if(sysroot_set(rootdir))
+    {
+        fprintf(stderr,"Can't open root directory %s\n",rootdir);
+        err=1;
+    }
+    else
+    {
+        fd=sysroot_open(fstab,O_RDONLY);
+        if(fd<0 || fstat(fd,&statbuf)==-1)
+        {
+            fprintf(stderr,"File %s%s not accessable.\n",rootdir,fstab);
+            err=1;
+        }
+        else
+            if((statbuf.st_mode & S_IFMT)!=S_IFREG)
+            {
+                fprintf(stderr,"File %s%s is not a regular file\n",rootdir,fstab);
+                err=1;
+            }
+        if(fd>=0)
+            close(fd);
+    }
     if(!strcmp(fstab,outfile))
     {
         fprintf(stderr,"Input file may not equal output file\n");
         err=1;
     }
     if(err)
+    {
+        unlink(devdiskfile);
         exit(1);
-    fin=fopen(fstab,"rb");
+    }
+    fin=sysroot_fopen(fstab);
     if(fin==NULL)
     {
         fprintf(stderr,"Can't open file \"%s\" for reading\n",fstab);
+        unlink(devdiskfile);
         exit(89);
     }
     if(*outfile != nullchar)
@@ -505,7 +603,16 @@ help:
      */
     debug("entering create dictionary\n");
     ini=create_dictionary();
+    /* only the attributes the template names are read, none without -t */
+    if(*annotemplate!=nullchar)
+        sysattr_fetch(ini,sysattr_need(annotemplate));
     fstabToDictMatch(fout);
+    dictionary_del(&ini);
+    devtable_del(&devs);
+    btrfs_free();
+    sysattr_free();
+    sysroot_close();
+    intern_free();                      /* last, the dictionaries point here */
 
     return 0;
 }
@@ -11,11 +11,10 @@
  *  This program formats the /etc/fstab and adds a xref for the UUID value to the device id     *
  *  It relies on /etc/fstab and on /dev/disk/by-uuid                                            *
  *                                                                                              *
- * The program creates two temporary files in /tmp and works with those file.                   *
  * The program uses a rudamentary deta dictionary to store the information obtained from        *
  * /dev/disk/by-uuid and from /dev/disk/by-label.                                               *
  *  Step 1 Parse the command line to determine files to read and or write                       *
- *  Step 2 Read the /dev/disk/by-uuid to /tmp/tempfile and use it to create entries into the DD *
+ *  Step 2 Read the links of /dev/disk/by-uuid and use them to create entries into the DD      *
  *         The DD will contain UUID and device-id pulled from /dev/disk/by-uuid                 *
  *  Step 3 read the /dev/disk/by-label and create additional entries into the DD                *
  *         The key is label, the variable is the device-id                                      *
@@ -53,6 +52,26 @@
 //#define NDEBUG                //enable if you want the debug macros, (they are in dictionary.h)
 
 #include "dictionary.h"
+#include "multipath.h"
+#include "parttable.h"
+#include "loopdev.h"
+#include "devtable.h"
+#include "fsprobe.h"
+#include "batch.h"
+#include "sysattr.h"
+#include "sysroot.h"
+#include "capture.h"
+#include "fsspec.h"
+#include "inputs.h"
+#include "plan.h"
+#include "mounttab.h"
+#include "rewrite.h"
+#include "fstabdiff.h"
+#include "conflict.h"
+#include "history.h"
+#include "colexport.h"
+#include "mntopt.h"
+#include "intern.h"
 // commented #includes are first declared in dictionary.h
 //#include <stdio.h>
 //#include <string.h>
@@ -67,6 +86,7 @@
 
 dictionary *ini;           //this is a data dictionary pointer. The DD will hold
 //the UUID value as key and the /dev value as data
+devtable *devs;            //device numbers (major:minor) to device names
 
 
 FILE *filein;
@@ -77,9 +97,53 @@ char outfile[PATH_MAX];
 char buffer[PATH_MAX];
 struct stat statbuf;
 char pgm[257];
-char devdiskfile[32]  ="/tmp/uuid.uXXXXXX.txt";
+char image[PATH_MAX];           /* -d raw disk image instead of /dev/disk */
+char batchfile[PATH_MAX];       /* -b list of jobs, one option set per line */
+int  jobs;                      /* -j parallel batch jobs, 0 = one per cpu */
+int  allinputs;                 /* -a fstab.d, crypttab and units too, see inputs.h */
+int  mountplan;                 /* -p mount waves instead of the fstab, see plan.h */
+int  fsckplan;                  /* -f fsck steps instead of the fstab, see plan.h */
+int  pathquery;                 /* -q paths on stdin to their fstab entry, see mounttab.h */
+int  rewriteto=-1;              /* -w namespace the specs are rewritten into, see rewrite.h */
+char devprefix[PATH_MAX+2]="/dev/";  /* printed in front of the device found */
+char annotemplate[256];         /* -t annotation template, see sysattr.h */
+char rootdir[PATH_MAX];         /* --root, fstab /dev /sys /proc are read under it */
+char capturefile[PATH_MAX];     /* --capture, snapshot of the device environment */
+char replayfile[PATH_MAX];      /* --replay, discovery served from a snapshot */
+char diffold[PATH_MAX];         /* --diff OLD NEW, see fstabdiff.h */
+char diffnew[PATH_MAX];
+char historyfile[PATH_MAX];     /* --history, the device map of each run, see history.h */
+char attime[64];                /* --at, the map at that time from --history */
+char exportfile[PATH_MAX];      /* --export, the entries as columns, see colexport.h */
+char hostname[256];             /* host column of --export */
+colwriter *exporter;
+unsigned bloombits;             /* --bloom, filter bits per dictionary key */
+
+enum { OPT_CAPTURE=256, OPT_REPLAY, OPT_DIFF, OPT_HISTORY, OPT_AT, OPT_EXPORT, OPT_BLOOM };
+static const struct option longopts[]=
+{
+    { "root",    required_argument, NULL, 'r' },
+    { "sysroot", required_argument, NULL, 'r' },
+    { "capture", required_argument, NULL, OPT_CAPTURE },
+    { "replay",  required_argument, NULL, OPT_REPLAY },
+    { "help",    no_argument,       NULL, 'h' },
+    { "all",     no_argument,       NULL, 'a' },
+    { "plan",    no_argument,       NULL, 'p' },
+    { "fsck",    no_argument,       NULL, 'f' },
+    { "query",   no_argument,       NULL, 'q' },
+    { "rewrite", required_argument, NULL, 'w' },
+    { "diff",    required_argument, NULL, OPT_DIFF },
+    { "history", required_argument, NULL, OPT_HISTORY },
+    { "at",      required_argument, NULL, OPT_AT },
+    { "export",  required_argument, NULL, OPT_EXPORT },
+    { "bloom",   required_argument, NULL, OPT_BLOOM },
+    { NULL,      0,                 NULL,  0  }
+};
 
 static void fstabToDictMatch(FILE *);
+static char *devnote(const char *);
+static int run(int ,char **);
+static int fstab_check(void);
 int main(int ,char **);
 const char NULLCHAR='\0';
 
@@ -117,6 +181,23 @@ char * strtrim(char *in,int option)
 }
 
 
+/**
+ * @brief devnote  The annotation for the device found: /dev/sdq3, or the
+ *                 -t template expanded for it
+ * @param devid    device name, or the "not found" text
+ * @return         static buffer, valid until the next call
+ */
+static char *devnote(const char *devid)
+{
+    static char note[PATH_MAX+300];
+
+    if(*annotemplate==NULLCHAR)
+        snprintf(note,sizeof(note),"%s%s",devprefix,devid);
+    else
+        sysattr_format(annotemplate,devprefix,devid,note,sizeof(note));
+    return note;
+}
+
 /**
  * @brief fstabToDictMatch
  *        This function matches each line of an fstab file to the
@@ -124,287 +205,297 @@ char * strtrim(char *in,int option)
  *        and from /dev/disk/by-label. 
  *        NOTE: NOTE:
  *        LABEL=sde1Spare /Development       ext4   defaults,noatime     1 2 
+ *        The first field is classified once by fsspec_parse(), which
+ *        gives the key to look up, whatever the kind of spec.
+ *        Conflicts with earlier entries (conflict.h) are written as a
+ *        #conflict comment above the entry and on stderr.
  * @param f the stream to where the output is to be written.
  */
 
 static void fstabToDictMatch(FILE *f)
 {
+    struct fsspec fs;
+    conflict *seen;
     char *devid=NULL;
-    char defs[96];
+    char *note;
+    char defs[PATH_MAX];
     char dmpodr[40];
     char dmpodr2[40];
     char fstype[40];
-    char mnt_name[64];
-    char label[96];
-    char uuidln[50];
+    char mnt_name[PATH_MAX];
+    char spec[PATH_MAX];
     char workarea[PATH_MAX];
+    char where[PATH_MAX];
+    char dev[32];
+    char clash[600];
 
 
     //FILE *fin;
     int i;
+    int lineno=0;
+    int clashes=0;
 
-    fin=fopen(fstab,"rb");
+    fin=sysroot_fopen(fstab);
     if(fin==NULL)
     {
         fprintf(stderr,"Can't open file \"%s\" for reading\n",fstab);
         exit(89);
     }
+    seen=conflict_new();
     while(!feof(fin))
     {
         if(NULL== (fgets(buffer,sizeof(buffer),fin)))
             continue;
+        lineno++;
 
         strcpy(workarea,buffer);
    	workarea[sizeof(workarea)-1]=NULLCHAR; 
         strtrim(workarea,3);
-        *label= NULLCHAR;
-        *mnt_name = NULLCHAR;
-        *fstype = NULLCHAR; 
-        *defs = NULLCHAR;
-        *dmpodr = NULLCHAR;
-        *dmpodr2 = NULLCHAR;
-        devid=NULL;
-        /******************    LABEL LOGIC ***************************/
-        if(!memcmp(workarea,"LABEL=",6))
+        debug("Processing workarea=[%s]\n\n",workarea);
+        *defs=*dmpodr=*dmpodr2=NULLCHAR;
+        i=sscanf(workarea,"%4095s %4095s%39s%4095s%39s%39s",spec,mnt_name,fstype,defs,dmpodr,dmpodr2);
+        if(i>=3 && *spec!='#')          /* checked on the way, see conflict.h */
         {
-            i=sscanf(workarea,"%s %s%s%s%s%s",label,mnt_name,fstype,defs,dmpodr,dmpodr2);
-            debug("sscan rc = %d label=%s, mount_name=%s device_id=%s\n",i,label+6,mnt_name,devid);
-            if (i==6)
+            mounttab_dev(ini,spec,dev,sizeof(dev));
+            fsspec_decode(strcpy(where,mnt_name));
+            if(conflict_check(seen,lineno,where,fstype,dev,clash,sizeof(clash)))
             {
-                devid =dictionary_get(ini,label+6,"not found");
-                fprintf(f,"%-42s %-25s %-7s %s\t%s %s #/dev/%s\n",label,mnt_name,fstype,defs,dmpodr,dmpodr2,devid);
-                continue;
+                clashes++;
+                fprintf(f,"#conflict line %d: %s\n",lineno,clash);
+                fprintf(stderr,"%s:%d: %s\n",fstab,lineno,clash);
             }
-            //fputs(buffer,f);  /* will fall through aand fail memcmp()  test */
-            //continue;
+            if(exporter!=NULL)
+                colexport_row(exporter,hostname,spec,where,fstype,defs,dev,atoi(dmpodr),atoi(dmpodr2));
         }
-
-        /******************************* END LABEL LOGIC ***********************/
-
-
-        if(memcmp(workarea,"UUID=",5))
+        if(i!=6 || fsspec_parse(spec,&fs)==SPEC_OTHER)
         {
-            fputs(buffer,f);
+            fputs(buffer,f);            /* comments, blank lines, proc, tmpfs */
             continue;
         }
-        debug("Processing workarea=[%s]\n\n",workarea);
-        /*
-         *  sscanf( workarea, format, field of pointers )
-         * Interpret  [^ ]      as a field ending in a blank
-         * Interpret  [^' ']    as a field ending in a blank
-         * Interpret [^ |\t]    as a field ending in blank or tab char
-         * Interpret [^' '|\t]  as a field ending in blank or tab char
-         * Interpret [^ |\t\n]  as a field ending in blank, tabchar or end-of-line
-         *
-         */
-
-        i=sscanf(workarea,"%s%s%s%s%s%s",
-                 uuidln,mnt_name,fstype,defs,dmpodr,dmpodr2);
-        if(i!=6)
+        debug("looking up [%s] in dictionary\n",fs.key);
+        if(fs.kind==SPEC_PATH)
         {
-            //fprintf(stderr,"I = %d\n",i);
-            fputs(buffer,f);
-            continue;
+            /* loop devices, swap files and image files, see filedev_fill() */
+            devid=fsspec_get(ini,&fs,NULL);
+            if(devid==NULL)
+            {
+                fputs(buffer,f);
+                continue;
+            }
+            note=devid;
+        }
+        else
+        {
+            devid=fsspec_get(ini,&fs,(char *)fs.notfound);
+            note=devnote(devid);
         }
-        debug("looking up [%s] in dictionary\n",uuidln);
-        debug("This buffer\n%s\n",buffer);
-
-        devid=dictionary_get(ini,uuidln+5,"*not found");
         debug("dictionary_get() returned [%s]\n",devid);
-        fprintf(f,"%-42s %-25s %-7s %s\t%s %s #/dev/%s\n",
-                uuidln,mnt_name,fstype,defs,dmpodr,dmpodr2,devid);
+        fprintf(f,"%-42s %-25s %-7s %s\t%s %s #%s\n",spec,mnt_name,fstype,defs,dmpodr,dmpodr2,note);
     }
+    if(clashes)
+        fprintf(stderr,"%d fstab entries conflict\n",clashes);
+    conflict_del(&seen);
     fclose(fin);
 }
 
 /**
- * @brief Dictionary_fill_LABEL_Entries
- *        Using the lines from ls -l /dev/disk/by-label
- *        parse the "line to create a data dictionary entry"
- *        NOTE. The fstab has /xyz   but tye by-label stores xyz
- * lrwxrwxrwx. 1 root root 10 Apr 25 16:05 sdb9xfceHome -> ../../sdb5
- * @param line
- *        The line from an fstab.
+ * @brief create_dictionary
+ *        Reading the links of /dev/disk/by-uuid and /dev/disk/by-label, under
+ *        the --root directory if one is given,
+ *        create the ram array that holds
+ *        key=uuid, val=device_id
+ * @return the pointer to the dictionary structure.
  */
-static void Dictionary_fill_LABEL_Entries(char *line)
+static dictionary * create_dictionary(void)
 {
-    char label[64];
-    char devptr[8];
-    char *cp;
-    int i;
-
-    cp=strchr(line,'\n');
-    if (cp)
-        *cp=NULLCHAR;
-    *label=*devptr=NULLCHAR;
-    cp=strrchr(line,'/');       /*right most (last) slash in the line */
-    if(cp)
-        strcpy(devptr,cp+1);
-    else
-        return;
-    strtrim(devptr,3);
-
-    i=sscanf(line+40,"%s",label);
-    if (i!=1)
-        return;
+    ini=dictionary_new(32,"uuid"); /* ini is global */
+    if(ini==NULL)
+        exit(32);
 
-    debug("label=%s devptr=%s\n",label,devptr);
-    debug("label=%s Hash %10.8X\n",label,dictionary_hash(label)); 
-    if(*label!=NULLCHAR)
+    multipath_load();               /* paths to one LUN are stored once */
+    switch(fsspec_links(ini,"/dev/disk/by-uuid",""))
     {
-      if(dictionary_set(ini,label,devptr))
-      {
-          fprintf(stderr,"dictionary_set(%s,%s)) failed\n",
-                  label,devptr);
-          dictionary_del(&ini);
-          exit(11);
-      }
+    case -1:
+        fprintf(stderr,"Can't read %s/dev/disk/by-uuid\n",sysroot_dir());
+        /* FALLTHROUGH */
+    case 0:
+        break;
+    default:
+        fprintf(stderr,"dictionary_set() failed for /dev/disk/by-uuid\n");
+        dictionary_del(&ini);
+        exit(29);
     }
-#if 0
-    if(dictionary_set(ini,devptr,label))
+    if(fsspec_links(ini,"/dev/disk/by-label","")>0)
     {
-        fprintf(stderr,"dictionary_set(%s,%s)) failed\n",
-                devptr,label);
+        fprintf(stderr,"dictionary_set() failed for /dev/disk/by-label\n");
         dictionary_del(&ini);
-        exit(19);
+        exit(11);
     }
+    fsspec_links(ini,"/dev/disk/by-id","ID=");  /* ID= keys, best effort */
+    parttable_fill(ini);            /* PARTUUID= and PARTLABEL= keys */
+    loopdev_fill(ini);              /* loop device backing files */
+    devs=devtable_new();            /* major:minor -> device name */
+    devtable_load(devs);
+    filedev_fill(ini,devs,fstab);   /* /dev/loopN, swap and image file sources */
+    multipath_free();
+#ifdef NDEBUG
+    debug("%s: showing meta info\n",__FUNCTION__);
+    dictionary_meta(ini,stdout);
+    dictionary_dump(ini,stdout);
+    fprintf(stdout,"%s completed\n",__FUNCTION__);
 #endif
-    debug("label=[%s] dev=[%s]\n",label,devptr);
-}
 
+    return ini;
+}
 
 /**
- * @brief Dictionary_fill_UUID_Entries
- * @param line
- *      "lrwxrwxrwx. 1 root root 10 Apr 12 16:26 119a207e-0480-4298-907b-4f16a8c6316d -> ../../sdb7"
- *                              column 40  ----->|                          look for this --->|
- *
+ * @brief image_fill_Entries
+ *        parttable_read() callback. Probe the superblock of the partition
+ *        inside the image and store UUID, LABEL, PARTUUID and PARTLABEL
+ *        keys with the value "pN".
+ * @param pe  the partition found in the image
+ * @param arg the image file descriptor
+ * @return 0 to continue the walk
  */
-static void  Dictionary_fill_UUID_Entries(char *line)
+static int image_fill_Entries(const struct ptentry *pe, void *arg)
 {
-
-    char uuidptr[50];
-    char devptr[4];
-    char *cp;
-    char *uptr;
-
-
-    strtrim(line,3);
-    uptr=strrchr(line,':');            /* where the UUID= starts 4 after date minutes field*/
-    if(uptr==NULL)
+    struct fsprobe fp;
+    char devptr[16];
+    char key[sizeof(pe->partlabel)+16];
+
+    sprintf(devptr,"p%d",pe->partno);
+    sprintf(key,"PARTUUID=%s",pe->partuuid);
+    dictionary_set(ini,key,devptr);
+    if(*pe->partlabel!=NULLCHAR)
     {
-        debug("%s format missing \":\"\n",line);
-        return;
-    }
-    uptr+=4;
-    memcpy(uuidptr,uptr,sizeof(uuidptr)-1);        //to include all of the part
-    uuidptr[sizeof(uuidptr)-1]=NULLCHAR;		 
-    cp=strchr(uuidptr,' ');
-    if(cp)
-        *cp=NULLCHAR;
-    else
-       {
-         fprintf(stderr,"Can't process line %s\n",line);
-         return;
-       }
-    cp=strrchr(line,'/');
-    if(cp)
-        strcpy(devptr,cp+1);
-    else
-    {
-        fprintf(stderr,"Line %s Format is invalid\n",line);
-        dictionary_del(&ini);
-        exit(27);
-    }
-  
-    debug("UUID=[%s] Dev=[%s]\n",uuidptr,devptr);
-    if(dictionary_set(ini,uuidptr,devptr))
-    {
-        fprintf(stderr,"dictionary_set(ini,%s,%s)) failed\n",
-                uuidptr,devptr);
-        dictionary_del(&ini);
-        exit(29);
+        sprintf(key,"PARTLABEL=%s",pe->partlabel);
+        dictionary_set(ini,key,devptr);
     }
+    if(fsprobe_read(*(int *)arg,pe->start,pe->size,&fp)<=0)
+        return 0;
+    debug("%s%s type=%s uuid=%s label=%s\n",devprefix,devptr,fp.type,fp.uuid,fp.label);
+    multipath_set(ini,fp.uuid,devptr);  /* no LUNs, the canonical UUID key */
+    if(*fp.label!=NULLCHAR)
+        multipath_set(ini,fp.label,devptr);
+    return 0;
 }
 
 /**
- * @brief create_dictionary
- *        Reading the ls -l /dev/disk/by-uuid/ image  Image similar to next line
- *        lrwxrwxrwx. 1 root root 10 Apr 12 16:26 119a207e-0480-4298-907b-4f16a8c6316d -> ../../sdb7
- *        create the ram array that holds
- *        key=uuid, val=device_id
+ * @brief image_dictionary
+ *        Offline variant of create_dictionary(). The partition table of
+ *        a raw disk image is read and every partition's superblock is
+ *        probed at its byte offset with pread(). No loop device, no root.
+ *        An image without partition table is probed as one filesystem.
+ *        Annotations are printed as #image:pN
  * @return the pointer to the dictionary structure.
  */
-static dictionary * create_dictionary(void)
+static dictionary * image_dictionary(void)
 {
-    FILE *filein;
-    const char *LINEHEAD="lrwxrwxrwx.";
+    struct fsprobe fp;
+    int fd;
 
-    ini=dictionary_new(32,"uuid"); /* ini is global */
+    ini=dictionary_new(32,"image");
     if(ini==NULL)
         exit(32);
-
-    close(mkstemps(devdiskfile,4));
-    sprintf(buffer,"ls -l /dev/disk/by-uuid >%s",devdiskfile);
-    system(buffer);
-#ifdef NDEBUG
-    sprintf(buffer,"cat %s",devdiskfile);
-    system( buffer);
-#endif
-
-    filein=fopen(devdiskfile,"rb");
-    if(filein==NULL)
+    fd=open(image,O_RDONLY|O_CLOEXEC);
+    if(fd<0)
     {
-        fprintf(stderr,"Can't open %s\n",devdiskfile);
-        return ini;
+        fprintf(stderr,"Can't open image \"%s\" for reading\n",image);
+        exit(33);
     }
-
-    while(!feof(filein))
+    snprintf(devprefix,sizeof(devprefix),"%s:",image);
+    if(parttable_read(fd,512,image_fill_Entries,&fd)<0)
     {
-        fgets(buffer,sizeof(buffer),filein);
-        if(memcmp(LINEHEAD,buffer,sizeof(LINEHEAD)-1))
+        if(fsprobe_read(fd,0,0,&fp)>0)
         {
-            debug("Rejecting: %s",buffer);
-            continue;
+            multipath_set(ini,fp.uuid,"p0");
+            if(*fp.label!=NULLCHAR)
+                multipath_set(ini,fp.label,"p0");
         }
-        Dictionary_fill_UUID_Entries(buffer);
+        else
+            fprintf(stderr,"%s: no partition table or filesystem found\n",image);
     }
-    fclose(filein);
+    close(fd);
+    return ini;
+}
 
-    sprintf(buffer,"ls -l /dev/disk/by-label >%s",devdiskfile);
-    system(buffer);
-#ifdef NDEBUG
-    sprintf(buffer,"cat %s",devdiskfile);
-    system( buffer);
-#endif
+/**
+ * @brief fstab_check  The input must be a regular file. It is looked up
+ *                     under the --root directory when one is given
+ * @return 0 if Ok, 1 otherwise
+ */
+static int fstab_check(void)
+{
+    int fd;
 
-    filein=fopen(devdiskfile,"rb");
-    if(filein==NULL)
+    fd=sysroot_open(fstab,O_RDONLY);
+    if(fd<0 || fstat(fd,&statbuf)==-1)
     {
-        fprintf(stderr,"Can't open %s\n",devdiskfile);
-        return ini;
+        fprintf(stderr,"File %s%s not accessable.\n",sysroot_dir(),fstab);
+        if(fd>=0)
+            close(fd);
+        return 1;
     }
-
-    while(!feof(filein))
+    close(fd);
+    if((statbuf.st_mode & S_IFMT)!=S_IFREG)
     {
-        fgets(buffer,sizeof(buffer),filein);
-        if(memcmp(LINEHEAD,buffer,sizeof(LINEHEAD)-1))
-        {
-            debug("Rejecting: %s",buffer);
-            continue;
-        }
-        Dictionary_fill_LABEL_Entries(buffer);
+        fprintf(stderr,"File %s%s is not a regular file\n",sysroot_dir(),fstab);
+        return 1;
     }
-    fclose(filein);
-    unlink(devdiskfile);
-#ifdef NDEBUG
-    debug("%s: showing meta info\n",__FUNCTION__);
-    dictionary_meta(ini,stdout);
-    dictionary_dump(ini,stdout);
-    fprintf(stdout,"%s completed\n",__FUNCTION__);
-#endif
+    return 0;
+}
 
-    return ini;
+/**
+ * @brief help  Display the help information on stderr
+ * @param argv0 the program name as invoked
+ */
+static void help(char *argv0)
+{
+    if(memcmp("./",argv0,2))
+        sprintf(pgm,"%s/%s",getcwd(buffer,sizeof(buffer)),basename(argv0) );
+    else
+        strcpy(pgm,argv0);
+    fprintf(stderr,"%s Help Information\n",pgm);
+    strcpy(pgm,basename(argv0));
+    fprintf(stderr,"%s [Optonal -i AlternateInput] [-o alternateOutput] -h This message!\n", pgm);
+    fprintf(stderr,"\tWithout arguments %s reads /etc/fstab and writes to standard output\n",pgm);
+    fprintf(stderr,"\nUse as: %s -i Your_Alternate_Input  -o Your.output.file\n",pgm);
+    fprintf(stderr,"%s reads the input file and appends the device info to it.\n\n",pgm);
+    fprintf(stderr,"%s processes the /etc/fstab or a copy of the /etc/fstab and reformats it\n"
+                   "adding a #/dev/xxxxx reference, where xxxx is obtained from the /dev/disk/by-uuid\n"
+                   "or from /dev/disk/by-label.  This program written by Leslie Satenstein 25April 2016\n",pgm);
+    fprintf(stderr,"If uncertain about %s's use, copy /etc/fstab to /tmp and try it out\n",pgm);
+    fprintf(stderr,"\n-d disk.img   cross reference against the partitions of a raw disk image\n"
+                   "              instead of /dev/disk (no loop device, no root needed)\n");
+    fprintf(stderr,"-b listfile   run one job per line of listfile, each line holding the\n"
+                   "              options of that job, e.g. -d a.img -i a.fstab -o a.xref\n");
+    fprintf(stderr,"-j N          run N batch jobs at the same time (default one per cpu)\n");
+    fprintf(stderr,"--root dir    read the fstab, /dev, /sys and /proc of a container root or a\n"
+                   "              captured tree, symlinks are resolved inside dir (also -r)\n");
+    fprintf(stderr,"--capture f   write everything discovery reads to the file f and stop\n");
+    fprintf(stderr,"--replay f    run against a capture file instead of this system\n");
+    fprintf(stderr,"-a            also read /etc/fstab.d, /etc/crypttab and the systemd .mount\n"
+                   "              and .swap units, and write one tab separated report (--all)\n");
+    fprintf(stderr,"-p            write the mount plan: the fstab entries as waves that can be\n"
+                   "              mounted in parallel, one disk per wave (--plan)\n");
+    fprintf(stderr,"-f            write the fsck plan: the pass numbers split into steps so\n"
+                   "              that no disk is checked twice at once (--fsck)\n");
+    fprintf(stderr,"-q            read paths from standard input, write for each the fstab\n"
+                   "              entry and device holding it (--query)\n");
+    fprintf(stderr,"-w UUID       rewrite the first field of every entry into UUID=, LABEL=,\n"
+                   "              PARTUUID= or PARTLABEL=, keeping all other bytes (--rewrite)\n");
+    fprintf(stderr,"--history f   append the device map of this run to f, changes only\n"
+                   "--at time     with --history f, write the map as it was at time\n"
+                   "              ('2026-10-13 14:00' or @epoch) and stop\n");
+    fprintf(stderr,"--export f    also write the entries to f as columns (host, spec, mount,\n"
+                   "              type, options, device, dump, pass) for analytics\n");
+    fprintf(stderr,"--bloom n     a Bloom filter of n bits per key in front of the device map,\n"
+                   "              lookups of absent keys mostly stop there; statistics on stderr\n");
+    fprintf(stderr,"--diff A B    what changes from fstab A to fstab B once the specs are resolved:\n"
+                   "              mounts added, removed, moved, on another device, new options\n");
+    fprintf(stderr,"-t template   annotation template, e.g. -t '%%d %%s %%r %%m' gives\n"
+                   "              #/dev/sdq3 3.6T HDD ST4000NM   (%%d device, %%n name,\n"
+                   "              %%s size, %%r HDD/SSD, %%m model, %%S serial)\n");
 }
 
 /**
@@ -415,61 +506,41 @@ static dictionary * create_dictionary(void)
  */
 int main(int argc, char *argv[])
 {
+    return run(argc,argv);
+}
+
+/**
+ * @brief run
+ *        The body of main(). A batch (-b) calls it again in a forked child
+ *        for each line of the batch list.
+ * @param argc
+ * @param argv
+ * @return exit status
+ */
+static int run(int argc, char *argv[])
+{
+    time_t when;
+    mounttab *mt;
+    dictionary *rev;
     int c=0;
     int err=0;
     *outfile=NULLCHAR;
+    *batchfile=NULLCHAR;
     fout=stdout;
-    unlink("/tmp/uuid.*");
-    close(mkstemps(devdiskfile,4));
-    debug("devdiskfile=%s\n",devdiskfile);
-    if(!isatty(fileno(stdout)))
-    {
-       fprintf(stderr,"%s: Redirectecting output nulls the output file\n",argv[0]);
-       fprintf(stderr,"\t Use %s -o filename to create filename \n",argv[0]);
-       goto help;
-    }
-    while((c=(getopt(argc,argv,"HhI:i:o:O:")))  !=-1 )
+    while((c=(getopt_long(argc,argv,"HhaApPfFqQw:W:I:i:o:O:d:D:b:B:j:J:t:T:r:R:",longopts,NULL)))  !=-1 )
     {
         switch (c)
         {
         case 'h':
         case 'H':
-help:
-            if(memcmp("./",argv[0],2))
-                sprintf(pgm,"%s/%s",getcwd(buffer,sizeof(buffer)),basename(argv[0]) );
-            else
-                strcpy(pgm,argv[0]);
-            fprintf(stderr,"%s Help Information\n",pgm);
-            strcpy(pgm,basename(argv[0]));
-            fprintf(stderr,"%s [Optonal -i AlternateInput] [-o alternateOutput] -h This message!\n", pgm);
-            fprintf(stderr,"\tWithout arguments %s reads /etc/fstab and writes to standard output\n",pgm);
-            fprintf(stderr,"\nUse as: %s -i Your_Alternate_Input  -o Your.output.file\n",pgm);
-            fprintf(stderr,"%s reads the input file and appends the device info to it.\n\n",pgm);
-            fprintf(stderr,"%s processes the /etc/fstab or a copy of the /etc/fstab and reformats it\n"
-                           "adding a #/dev/xxxxx reference, where xxxx is obtained from the /dev/disk/by-uuid\n"
-                           "or from /dev/disk/by-label.  This program written by Leslie Satenstein 25April 2016\n",pgm);
-            fprintf(stderr,"If uncertain about %s's use, copy /etc/fstab to /tmp and try it out\n",pgm);
+            help(argv[0]);
             err=1;
             break;
 
         case 'i':
         case 'I':
             if(strlen(optarg))
-            {
-                strcpy(fstab,optarg);
-                if(stat(fstab,&statbuf) ==-1)
-                {
-                    fprintf(stderr,"File %s not accessable.\n",fstab);
-                    err=1;
-                }
-                else
-                    if((statbuf.st_mode & S_IFMT)!=S_IFREG)
-                    {
-                        fprintf(stderr,"File %s is not a regular file\n",fstab);
-                        err=1;
-                    }
-
-            }
+                strcpy(fstab,optarg);   /* checked below, under --root */
             else
             {
                 fprintf(stderr,"-i needs a path/filename\n");
@@ -485,10 +556,156 @@ help:
             }
             strcpy(outfile,optarg);
             break;
+        case 'd':
+        case 'D':
+            strcpy(image,optarg);
+            break;
+        case 'b':
+        case 'B':
+            strcpy(batchfile,optarg);
+            break;
+        case 'a':
+        case 'A':
+            allinputs=1;
+            break;
+        case 'p':
+        case 'P':
+            mountplan=1;
+            break;
+        case 'f':
+        case 'F':
+            fsckplan=1;
+            break;
+        case 'q':
+        case 'Q':
+            pathquery=1;
+            break;
+        case 'w':
+        case 'W':
+            rewriteto=rewrite_target(optarg);
+            if(rewriteto<0)
+            {
+                fprintf(stderr,"-w %s: UUID, LABEL, PARTUUID or PARTLABEL\n",optarg);
+                err=1;
+            }
+            break;
+        case 'j':
+        case 'J':
+            jobs=atoi(optarg);
+            break;
+        case 't':
+        case 'T':
+            snprintf(annotemplate,sizeof(annotemplate),"%s",optarg);
+            break;
+        case 'r':
+        case 'R':
+            strcpy(rootdir,optarg);
+            break;
+        case OPT_CAPTURE:
+            strcpy(capturefile,optarg);
+            break;
+        case OPT_REPLAY:
+            strcpy(replayfile,optarg);
+            break;
+        case OPT_DIFF:
+            strcpy(diffold,optarg);
+            break;
+        case OPT_HISTORY:
+            strcpy(historyfile,optarg);
+            break;
+        case OPT_AT:
+            snprintf(attime,sizeof(attime),"%s",optarg);
+            break;
+        case OPT_EXPORT:
+            strcpy(exportfile,optarg);
+            break;
+        case OPT_BLOOM:
+            bloombits=atoi(optarg);
+            break;
         default:
             break;
         }
     }
+    if(*diffold!=NULLCHAR)
+    {
+        if(optind<argc)
+            snprintf(diffnew,sizeof(diffnew),"%s",argv[optind]);
+        else
+        {
+            fprintf(stderr,"--diff needs two files: --diff OLD NEW\n");
+            err=1;
+        }
+    }
+    if(*batchfile!=NULLCHAR)
+    {
+        if(err)
+            exit(41);
+        /* each job starts from the options given on this command line */
+        return batch_run(argv[0],batchfile,jobs,run) ? 43 : 0;
+    }
+    if(*attime!=NULLCHAR)           /* the log alone, no discovery */
+    {
+        when=history_time(attime);
+        if(*historyfile==NULLCHAR || when==(time_t)-1)
+        {
+            fprintf(stderr,"Use --history FILE --at 'YYYY-MM-DD HH:MM' or --at @EPOCH\n");
+            exit(41);
+        }
+        if(*outfile!=NULLCHAR && (fout=fopen(outfile,"wb"))==NULL)
+        {
+            fprintf(stderr,"Unable to create %s\n",outfile);
+            exit(41);
+        }
+        c=history_at(fout,historyfile,when);
+        if(fout!=stdout)
+            fclose(fout);
+        if(c<0)
+            fprintf(stderr,"No device map in %s at %s\n",historyfile,attime);
+        return c<0 ? 45 : 0;
+    }
+    /* the host of --export: the capture, the root, or this system */
+    if(*replayfile!=NULLCHAR || *rootdir!=NULLCHAR)
+        snprintf(hostname,sizeof(hostname),"%s",basename(*replayfile ? replayfile : rootdir));
+    else if(gethostname(hostname,sizeof(hostname)))
+        strcpy(hostname,"localhost");
+    if(*replayfile!=NULLCHAR)
+    {
+        if(*capturefile!=NULLCHAR || *rootdir!=NULLCHAR)
+        {
+            fprintf(stderr,"--replay can not be used with --capture or --root\n");
+            exit(41);
+        }
+        if(replay_open(replayfile))
+        {
+            fprintf(stderr,"Can't replay %s\n",replayfile);
+            exit(41);
+        }
+    }
+    if(sysroot_set(rootdir))
+    {
+        fprintf(stderr,"Can't open root directory %s\n",rootdir);
+        err=1;
+    }
+    else
+        err|=fstab_check();
+    if(*capturefile!=NULLCHAR && !err)
+    {
+        c=capture_write(capturefile,fstab);
+        if(c<0)
+        {
+            fprintf(stderr,"Can't write %s\n",capturefile);
+            return 44;
+        }
+        fprintf(stderr,"%d paths captured in %s\n",c,capturefile);
+        return 0;
+    }
+    if(*outfile==NULLCHAR && !isatty(fileno(stdout)) && !pathquery && *diffold==NULLCHAR)
+    {
+       fprintf(stderr,"%s: Redirectecting output nulls the output file\n",argv[0]);
+       fprintf(stderr,"\t Use %s -o filename to create filename \n",argv[0]);
+       help(argv[0]);
+       err=1;
+    }
     if(!strcmp(fstab,outfile))
     {
         fprintf(stderr,"Input file may not equal output file\n");
@@ -496,7 +713,7 @@ help:
     }
     if(err)
         exit(41);
-    fin=fopen(fstab,"rb");
+    fin=sysroot_fopen(fstab);
     if(fin==NULL)
     {
         fprintf(stderr,"Can't open file \"%s\" for reading\n",fstab);
@@ -517,9 +734,24 @@ help:
      * will contain output from ls -l  /dev/disk/by-uuid
      * then
      * create the dictionary and entries that will hold the UUID and /dev/xxx
+     * With -d, the dictionary is built from the disk image instead.
      */
 
-    ini=create_dictionary();  //uses devdiskfile
+    if(allinputs)                   /* read while discovery runs */
+        inputs_start(fstab);
+    if(*image != NULLCHAR)
+        ini=image_dictionary();
+    else
+        ini=create_dictionary();
+    /* only the attributes the template names are read, none without -t */
+    if(*annotemplate!=NULLCHAR && *image==NULLCHAR)
+        sysattr_fetch(ini,sysattr_need(annotemplate));
+    if(bloombits>0 && dictionary_bloom(ini,bloombits)<0)
+        fprintf(stderr,"No memory for the Bloom filter\n");
+    dictionary_bloomcount(ini,1);       /* one thread, for the stats line */
+    if(*historyfile!=NULLCHAR && *image==NULLCHAR
+       && history_append(historyfile,ini,time(NULL))<0)
+        fprintf(stderr,"Can't append to %s\n",historyfile);
 
 
 #ifdef NDEBUG       
@@ -534,7 +766,51 @@ help:
         fprintf(stderr,"Output is to %s\n\n",outfile);
 
     
-    fstabToDictMatch(fout);
+    if(*diffold!=NULLCHAR)
+    {
+        if(fstabdiff_write(fout,ini,diffold,diffnew)<0)
+            fprintf(stderr,"Can't read %s or %s\n",diffold,diffnew);
+    }
+    else if(mountplan)
+        plan_write(fout,ini,fstab);
+    else if(fsckplan)
+        fsck_write(fout,ini,fstab);
+    else if(rewriteto>=0)
+    {
+        rev=rewrite_reverse(ini);
+        c=rewrite_stream(fout,fin,fstab,ini,rev,rewriteto);
+        fclose(fin);
+        dictionary_del(&rev);
+        if(c)
+            fprintf(stderr,"%d entries not converted\n",c);
+    }
+    else if(pathquery)
+    {
+        mt=mounttab_load(ini,fstab,MT_NOAUTO);
+        if(mt!=NULL)
+            mounttab_query(fout,stdin,mt);
+        mounttab_del(&mt);
+    }
+    else if(allinputs)
+        inputs_report(fout,ini,devnote);
+    else
+    {
+        if(*exportfile!=NULLCHAR && (exporter=colexport_open(exportfile))==NULL)
+            fprintf(stderr,"Unable to create %s\n",exportfile);
+        fstabToDictMatch(fout);
+        if(exporter!=NULL && colexport_close(exporter)<0)
+            fprintf(stderr,"Error writing %s\n",exportfile);
+        exporter=NULL;
+    }
+    if(fout!=stdout)
+        fclose(fout);
+    dictionary_bloomstats(ini,stderr);  /* nothing without --bloom */
     dictionary_del(&ini);
+    devtable_del(&devs);
+    sysattr_free();
+    sysroot_close();
+    replay_close();
+    mntopt_free();
+    intern_free();                      /* last, the dictionaries point here */
     return 0;
 }
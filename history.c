@@ -0,0 +1,408 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    history.c
+   @author  Leslie Satenstein
+   @brief   Delta encoded device map history (see history.h)
+
+   A map is an array of key/value pairs sorted by key. The delta between
+   two maps and the replay of a delta are both one merge of sorted
+   arrays. The log is locked with flock() while a run appends to it.
+*/
+/*--------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+#include "history.h"
+#include "fsspec.h"
+#include <limits.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+struct hkv
+{
+    char *key;
+    char *val;
+};
+
+struct hmap
+{
+    struct hkv *kv;
+    int         n,size;
+};
+
+struct hidx
+{
+    int64_t time;
+    int64_t off;                        /* the record in the log */
+    int64_t base;                       /* the checkpoint it builds on */
+};
+
+/*--------------------------------------------------------------------------*/
+static void map_add(struct hmap *m, const char *key, const char *val)
+{
+    void *p;
+
+    if(m->n==m->size)
+    {
+        m->size= m->size ? 2*m->size : 64;
+        p=realloc(m->kv,m->size*sizeof(struct hkv));
+        if(p==NULL)
+            exit(-1);
+        m->kv=p;
+    }
+    m->kv[m->n].key=strdup(key);
+    m->kv[m->n].val= val ? strdup(val) : NULL;
+    if(m->kv[m->n].key==NULL)
+        exit(-1);
+    m->n++;
+}
+
+static void map_free(struct hmap *m)
+{
+    int i;
+
+    for(i=0;i<m->n;i++)
+    {
+        free(m->kv[i].key);
+        free(m->kv[i].val);
+    }
+    free(m->kv);
+    memset(m,0,sizeof(*m));
+}
+
+static int by_key(const void *a, const void *b)
+{
+    return strcmp(((const struct hkv *)a)->key,((const struct hkv *)b)->key);
+}
+
+/*--------------------------------------------------------------------------*/
+/* m with delta applied, a NULL value removes the key                      */
+static void map_apply(struct hmap *m, const struct hmap *delta)
+{
+    struct hmap out={NULL,0,0};
+    int i=0,j=0,c;
+
+    while(i<m->n || j<delta->n)
+    {
+        c= i==m->n ? 1 : j==delta->n ? -1 : strcmp(m->kv[i].key,delta->kv[j].key);
+        if(c<0)
+        {
+            map_add(&out,m->kv[i].key,m->kv[i].val);
+            i++;
+            continue;
+        }
+        if(delta->kv[j].val!=NULL)
+            map_add(&out,delta->kv[j].key,delta->kv[j].val);
+        if(c==0)
+            i++;
+        j++;
+    }
+    map_free(m);
+    *m=out;
+}
+
+/*--------------------------------------------------------------------------*/
+/* s with the fstab escapes for tab, newline and backslash                 */
+static void kv_write(FILE *f, int tag, const char *key, const char *val)
+{
+    const char *s;
+    int k;
+
+    fputc(tag,f);
+    for(k=0;k<2;k++)
+    {
+        s= k ? val : key;
+        if(s==NULL)
+            break;
+        if(k)
+            fputc('\t',f);
+        for(;*s;s++)
+            if(*s=='\t' || *s=='\n' || *s=='\\')
+                fprintf(f,"\\%03o",(unsigned char)*s);
+            else
+                fputc(*s,f);
+    }
+    fputc('\n',f);
+}
+
+/*--------------------------------------------------------------------------*/
+/* the records of log from off up to end, replayed into m                  */
+static void log_replay(FILE *log, int64_t off, int64_t end, struct hmap *m)
+{
+    struct hmap delta={NULL,0,0};
+    char  *line=NULL;
+    char  *tab;
+    size_t cap=0;
+    ssize_t len;
+
+    fseeko(log,off,SEEK_SET);
+    while(ftello(log)<end && (len=getline(&line,&cap,log))>0)
+    {
+        if(line[len-1]=='\n')
+            line[len-1]='\0';
+        tab=strchr(line,'\t');
+        if(tab!=NULL)
+            *tab++='\0';
+        switch(*line)
+        {
+        case '@':
+            map_apply(m,&delta);
+            map_free(&delta);
+            if(strstr(line," F ")!=NULL)
+                map_free(m);            /* a full map follows */
+            break;
+        case '=':
+        case '+':
+            map_add(&delta,fsspec_decode(line+1),tab ? fsspec_decode(tab) : "");
+            break;
+        case '-':
+            map_add(&delta,fsspec_decode(line+1),NULL);
+            break;
+        }
+    }
+    map_apply(m,&delta);
+    map_free(&delta);
+    free(line);
+}
+
+/*--------------------------------------------------------------------------*/
+/* the index of log, rebuilt if it does not end at the last record         */
+static struct hidx *index_load(const char *file, FILE *log, int *n)
+{
+    char   path[PATH_MAX+8];
+    char  *line=NULL;
+    size_t cap=0;
+    struct hidx *idx=NULL;
+    struct stat st;
+    int64_t off,base=0;
+    void  *p;
+    int    fd,size=0;
+    long long t;
+
+    *n=0;
+    snprintf(path,sizeof(path),"%s.idx",file);
+    fd=open(path,O_RDONLY|O_CLOEXEC);
+    if(fd>=0 && fstat(fd,&st)==0 && st.st_size%sizeof(struct hidx)==0 && st.st_size>0)
+    {
+        idx=malloc(st.st_size);
+        if(idx!=NULL && read(fd,idx,st.st_size)==st.st_size)
+        {
+            *n=st.st_size/sizeof(struct hidx);
+            fseeko(log,idx[*n-1].off,SEEK_SET);
+            if(getline(&line,&cap,log)>0 && *line=='@')
+            {
+                while(getline(&line,&cap,log)>0 && *line!='@')
+                    ;
+                if(feof(log))           /* the last record is the last */
+                {
+                    close(fd);
+                    free(line);
+                    return idx;
+                }
+            }
+        }
+        free(idx);
+        idx=NULL;
+        *n=0;
+    }
+    if(fd>=0)
+        close(fd);
+
+    debug("rebuilding %s\n",path);
+    fseeko(log,0,SEEK_SET);
+    for(off=0; getline(&line,&cap,log)>0; off=ftello(log))
+    {
+        if(*line!='@' || sscanf(line+1,"%lld",&t)!=1)
+            continue;
+        if(*n==size)
+        {
+            size= size ? 2*size : 256;
+            p=realloc(idx,size*sizeof(struct hidx));
+            if(p==NULL)
+                exit(-1);
+            idx=p;
+        }
+        if(strstr(line," F ")!=NULL)
+            base=off;
+        idx[*n].time=t;
+        idx[*n].off=off;
+        idx[(*n)++].base=base;
+    }
+    free(line);
+    fd=open(path,O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0644);
+    if(fd>=0)
+    {
+        if(write(fd,idx,*n*sizeof(struct hidx))<0)
+        {
+            debug("%s: %s\n",path,strerror(errno));
+        }
+        close(fd);
+    }
+    return idx;
+}
+
+/*--------------------------------------------------------------------------*/
+/* the map of record k                                                     */
+static void map_at(FILE *log, const struct hidx *idx, int n, int k, struct hmap *m)
+{
+    int64_t end;
+
+    fseeko(log,0,SEEK_END);
+    end= k+1<n ? idx[k+1].off : ftello(log);
+    log_replay(log,idx[k].base,end,m);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief history_append  Rebuild the last map, merge it with the sorted
+ *                        dictionary, write the delta or a checkpoint
+ */
+/*--------------------------------------------------------------------------*/
+int history_append(const char *file, const dictionary *d, time_t now)
+{
+    char   path[PATH_MAX+8];
+    struct hmap prev={NULL,0,0};
+    struct hmap cur={NULL,0,0};
+    struct hmap delta={NULL,0,0};
+    struct hidx *idx,e;
+    FILE  *log;
+    int    n,i,j,c,full,since;
+    int    fd;
+
+    fd=open(file,O_RDWR|O_CREAT|O_APPEND|O_CLOEXEC,0644);
+    if(fd<0 || (log=fdopen(fd,"a+"))==NULL)
+        return -1;
+    flock(fd,LOCK_EX);
+    idx=index_load(file,log,&n);
+    if(n>0)
+        map_at(log,idx,n,n-1,&prev);
+
+    for(i=0;i<d->size;i++)
+        if(d->key[i]!=NULL && d->val[i]!=NULL)
+            map_add(&cur,d->key[i],d->val[i]);
+    qsort(cur.kv,cur.n,sizeof(struct hkv),by_key);
+
+    for(i=j=0;i<prev.n || j<cur.n;)
+    {
+        c= i==prev.n ? 1 : j==cur.n ? -1 : strcmp(prev.kv[i].key,cur.kv[j].key);
+        if(c<0)
+            map_add(&delta,prev.kv[i++].key,NULL);
+        else if(c>0 || strcmp(prev.kv[i].val,cur.kv[j].val))
+        {
+            map_add(&delta,cur.kv[j].key,cur.kv[j].val);
+            j++;
+            i+= c==0;
+        }
+        else
+            i++,j++;
+    }
+
+    for(since=0; since<n && idx[n-1-since].off!=idx[n-1].base; since++)
+        ;
+    full= n==0 || since+1>=HISTORY_CHECKPOINT || (delta.n>0 && delta.n>=cur.n);
+    c=0;
+    if(full || delta.n>0)
+    {
+        fseeko(log,0,SEEK_END);
+        e.off=ftello(log);
+        e.time= n>0 && idx[n-1].time>now ? idx[n-1].time : now;    /* clock went back */
+        e.base= full ? e.off : idx[n-1].base;
+        fprintf(log,"@%lld %c %d\n",(long long)e.time,full ? 'F' : 'D',full ? cur.n : delta.n);
+        if(full)
+            for(i=0;i<cur.n;i++)
+                kv_write(log,'=',cur.kv[i].key,cur.kv[i].val);
+        else
+            for(i=0;i<delta.n;i++)
+                kv_write(log,delta.kv[i].val ? '+' : '-',delta.kv[i].key,delta.kv[i].val);
+        c= full ? cur.n : delta.n;
+        fflush(log);
+        snprintf(path,sizeof(path),"%s.idx",file);
+        fd=open(path,O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC,0644);
+        if(fd<0 || write(fd,&e,sizeof(e))!=sizeof(e))
+            c=-1;
+        if(fd>=0)
+            close(fd);
+    }
+    fclose(log);                        /* releases the lock */
+    free(idx);
+    map_free(&prev);
+    map_free(&cur);
+    map_free(&delta);
+    return c;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief history_at  The last record at or before t, by binary search
+ */
+/*--------------------------------------------------------------------------*/
+int history_at(FILE *f, const char *file, time_t t)
+{
+    struct hmap m={NULL,0,0};
+    struct hidx *idx;
+    FILE *log;
+    int   lo,hi,mid,n,i;
+
+    log=fopen(file,"r");
+    if(log==NULL)
+        return -1;
+    flock(fileno(log),LOCK_SH);
+    idx=index_load(file,log,&n);
+    lo=0;
+    hi=n;                               /* first record after t */
+    while(lo<hi)
+    {
+        mid=(lo+hi)/2;
+        if(idx[mid].time<=(int64_t)t)
+            lo=mid+1;
+        else
+            hi=mid;
+    }
+    if(lo==0)
+    {
+        fclose(log);
+        free(idx);
+        return -1;
+    }
+    map_at(log,idx,n,lo-1,&m);
+    fclose(log);
+    for(i=0;i<m.n;i++)
+        fprintf(f,"%s\t%s\n",m.kv[i].key,m.kv[i].val);
+    n=m.n;
+    map_free(&m);
+    free(idx);
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+time_t history_time(const char *s)
+{
+    static const char *formats[]={ "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d", NULL };
+    struct tm tm;
+    const char *end;
+    char *cp;
+    long long t;
+    int i;
+
+    if(*s=='@')
+    {
+        t=strtoll(s+1,&cp,10);
+        return *cp=='\0' && cp>s+1 ? (time_t)t : -1;
+    }
+    for(i=0;formats[i]!=NULL;i++)
+    {
+        memset(&tm,0,sizeof(tm));
+        end=strptime(s,formats[i],&tm);
+        if(end!=NULL && *end=='\0')
+        {
+            tm.tm_isdst=-1;
+            return mktime(&tm);
+        }
+    }
+    return -1;
+}
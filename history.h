@@ -0,0 +1,61 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    history.h
+   @author  Leslie Satenstein
+   @brief   History of the device map (--history FILE, --at TIME).
+
+   Every run appends its dictionary to FILE as the keys that changed since
+   the run before:
+       @1760000000 D 2
+       +3f0e-...	sdc1        added or changed
+       -LABEL=old              removed
+   A run that changes nothing writes nothing. Every HISTORY_CHECKPOINT
+   records, or when a delta would be as long, the whole map is written
+   instead (F, lines starting with '='). Keys and values are written with
+   the fstab escapes for tab, newline and backslash.
+
+   FILE.idx holds one fixed size entry per record, its time, its offset
+   and the offset of the checkpoint it builds on. The map at time T is a
+   binary search of the index, then at most HISTORY_CHECKPOINT records
+   replayed from the checkpoint. The index is rebuilt from FILE when it
+   is missing or does not match. A host running every 5 minutes with a
+   stable map writes nothing; every change costs one line.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include "dictionary.h"
+#include <time.h>
+
+#define HISTORY_CHECKPOINT 64   /* deltas at most between full maps */
+
+/**
+ * @brief history_append  Append the changes of d to the history
+ * @param file            the history log, created if needed
+ * @param d               the dictionary of this run
+ * @param now             the time of this run
+ * @return                number of keys written, -1 on error
+ */
+int history_append(const char *file, const dictionary *d, time_t now);
+
+/**
+ * @brief history_at  Write the map as it was at time t, key tab value
+ * @return            number of keys, -1 if file can not be read or
+ *                    starts after t
+ */
+int history_at(FILE *f, const char *file, time_t t);
+
+/**
+ * @brief history_time  Parse @EPOCH, YYYY-MM-DD, YYYY-MM-DD HH:MM or
+ *                      YYYY-MM-DD HH:MM:SS (local time)
+ * @return              the time, -1 if s is none of these
+ */
+time_t history_time(const char *s);
+
+#endif
@@ -0,0 +1,321 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    inputs.c
+   @author  Leslie Satenstein
+   @brief   fstab, fstab.d, crypttab and systemd unit inputs (see inputs.h)
+
+   Each reader fills its own list, so the readers share nothing but the
+   root directory descriptor. The report lists them in a fixed order,
+   fstab first, whatever order the readers finish in.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "inputs.h"
+#include "sysroot.h"
+#include "fsspec.h"
+#include <limits.h>
+#include <pthread.h>
+
+#define IN_FIELD 256
+
+struct inrec
+{
+    char *source;               /* the file, one copy per record */
+    int   line;
+    char  spec[IN_FIELD];
+    char  target[IN_FIELD];
+    char  type[32];
+};
+
+struct inlist
+{
+    struct inrec *rec;
+    int           n,size;
+};
+
+enum { IN_FSTAB, IN_CRYPTTAB, IN_UNITS, IN_KINDS };
+
+static struct inlist lists[IN_KINDS];
+static pthread_t     readers[IN_KINDS];
+static int           threaded[IN_KINDS];
+static char          mainfstab[PATH_MAX];
+
+static const char * const unitdirs[]=
+{
+    "/etc/systemd/system", "/run/systemd/system", "/run/systemd/generator", NULL
+};
+
+/*--------------------------------------------------------------------------*/
+static void in_add(struct inlist *l, const char *source, int line,
+                   const char *spec, const char *target, const char *type)
+{
+    struct inrec *r;
+    void *p;
+
+    if(l->n==l->size)
+    {
+        l->size= l->size ? 2*l->size : 32;
+        p=realloc(l->rec,l->size*sizeof(struct inrec));
+        if(p==NULL)
+            exit(-1);
+        l->rec=p;
+    }
+    r=&l->rec[l->n++];
+    r->source=strdup(source);
+    if(r->source==NULL)
+        exit(-1);
+    r->line=line;
+    snprintf(r->spec,sizeof(r->spec),"%s",spec);
+    snprintf(r->target,sizeof(r->target),"%s",target);
+    snprintf(r->type,sizeof(r->type),"%s",type);
+}
+
+/*--------------------------------------------------------------------------*/
+static int name_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a,*(char * const *)b);
+}
+
+/* the names in dir ending in one of the suffixes, sorted; free with       */
+/* names_free()                                                            */
+static int names_read(const char *dir, const char *suffix1, const char *suffix2, char ***names)
+{
+    struct dirent *de;
+    sysdir *d;
+    char **v=NULL;
+    void  *p;
+    size_t len;
+    int    n=0,size=0;
+
+    *names=NULL;
+    d=sysroot_opendir(dir);
+    if(d==NULL)
+        return 0;
+    while((de=sysroot_readdir(d))!=NULL)
+    {
+        len=strlen(de->d_name);
+        if(*de->d_name=='.'
+           || !((len>strlen(suffix1) && !strcmp(de->d_name+len-strlen(suffix1),suffix1))
+                || (suffix2 && len>strlen(suffix2) && !strcmp(de->d_name+len-strlen(suffix2),suffix2))))
+            continue;
+        if(n==size)
+        {
+            size= size ? 2*size : 16;
+            p=realloc(v,size*sizeof(char *));
+            if(p==NULL)
+                exit(-1);
+            v=p;
+        }
+        v[n]=strdup(de->d_name);
+        if(v[n]!=NULL)
+            n++;
+    }
+    sysroot_closedir(d);
+    qsort(v,n,sizeof(char *),name_cmp);
+    *names=v;
+    return n;
+}
+
+static void names_free(char **names, int n)
+{
+    while(n>0)
+        free(names[--n]);
+    free(names);
+}
+
+/*--------------------------------------------------------------------------*/
+/* fstab format: spec target type options dump pass                        */
+static void read_fstab(struct inlist *l, const char *path)
+{
+    char  line[PATH_MAX];
+    char  spec[IN_FIELD],target[IN_FIELD],type[32];
+    FILE *f;
+    int   lineno=0;
+
+    f=sysroot_fopen(path);
+    if(f==NULL)
+        return;
+    while(fgets(line,sizeof(line),f)!=NULL)
+    {
+        lineno++;
+        *type='\0';
+        if(sscanf(line," %255s %255s %31s",spec,target,type)<2 || *spec=='#')
+            continue;
+        in_add(l,path,lineno,spec,target,type);
+    }
+    fclose(f);
+}
+
+static void *fstab_reader(void *arg)
+{
+    struct inlist *l=arg;
+    char   path[PATH_MAX];
+    char **names;
+    int    n,i;
+
+    read_fstab(l,mainfstab);
+    n=names_read("/etc/fstab.d",".fstab",NULL,&names);
+    for(i=0;i<n;i++)
+    {
+        snprintf(path,sizeof(path),"/etc/fstab.d/%s",names[i]);
+        read_fstab(l,path);
+    }
+    names_free(names,n);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/* crypttab: name source keyfile options, the target is the mapper name    */
+static void *crypttab_reader(void *arg)
+{
+    struct inlist *l=arg;
+    char  line[PATH_MAX];
+    char  name[IN_FIELD],spec[IN_FIELD];
+    FILE *f;
+    int   lineno=0;
+
+    f=sysroot_fopen("/etc/crypttab");
+    if(f==NULL)
+        return NULL;
+    while(fgets(line,sizeof(line),f)!=NULL)
+    {
+        lineno++;
+        if(sscanf(line," %255s %255s",name,spec)!=2 || *name=='#')
+            continue;
+        in_add(l,"/etc/crypttab",lineno,spec,name,"crypt");
+    }
+    fclose(f);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/* one .mount or .swap unit: What=, Where= and Type=                       */
+static void read_unit(struct inlist *l, const char *path, const char *name)
+{
+    char  line[PATH_MAX];
+    char  what[IN_FIELD],where[IN_FIELD],type[32];
+    FILE *f;
+    int   lineno=0,whatline=0;
+    int   swap;
+
+    f=sysroot_fopen(path);
+    if(f==NULL)
+        return;
+    swap= strlen(name)>5 && !strcmp(name+strlen(name)-5,".swap");
+    *what='\0';
+    snprintf(where,sizeof(where),"%s",name);
+    snprintf(type,sizeof(type),"%s",swap ? "swap" : "");
+    while(fgets(line,sizeof(line),f)!=NULL)
+    {
+        lineno++;
+        if(!memcmp(line,"What=",5) && sscanf(line+5,"%255s",what)==1)
+            whatline=lineno;
+        else if(!memcmp(line,"Where=",6))
+            sscanf(line+6,"%255s",where);
+        else if(!memcmp(line,"Type=",5))
+            sscanf(line+5,"%31s",type);
+    }
+    fclose(f);
+    if(*what!='\0')
+        in_add(l,path,whatline,what,where,type);
+}
+
+static void *unit_reader(void *arg)
+{
+    struct inlist *l=arg;
+    const char * const *dir;
+    char   path[PATH_MAX];
+    char **names;
+    int    n,i;
+
+    for(dir=unitdirs;*dir!=NULL;dir++)
+    {
+        n=names_read(*dir,".mount",".swap",&names);
+        for(i=0;i<n;i++)
+        {
+            snprintf(path,sizeof(path),"%s/%s",*dir,names[i]);
+            read_unit(l,path,names[i]);
+        }
+        names_free(names,n);
+    }
+    return NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief inputs_start  One reader thread per kind of input
+ */
+/*--------------------------------------------------------------------------*/
+int inputs_start(const char *fstab)
+{
+    static void *(* const reader[IN_KINDS])(void *)=
+    {
+        [IN_FSTAB]=fstab_reader, [IN_CRYPTTAB]=crypttab_reader, [IN_UNITS]=unit_reader
+    };
+    int rc=0;
+    int k;
+
+    snprintf(mainfstab,sizeof(mainfstab),"%s",fstab);
+    for(k=0;k<IN_KINDS;k++)
+    {
+        threaded[k]= pthread_create(&readers[k],NULL,reader[k],&lists[k])==0;
+        if(!threaded[k])
+        {
+            reader[k](&lists[k]);       /* read it now instead */
+            rc=-1;
+        }
+    }
+    return rc;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief inputs_report  Resolve every entry against the dictionary
+ */
+/*--------------------------------------------------------------------------*/
+int inputs_report(FILE *f, const dictionary *d, char *(*note)(const char *))
+{
+    struct fsspec fs;
+    struct inrec *r;
+    const char *dev;
+    char *val;
+    int n=0;
+    int k,i;
+
+    for(k=0;k<IN_KINDS;k++)
+        if(threaded[k])
+        {
+            pthread_join(readers[k],NULL);
+            threaded[k]=0;
+        }
+    fprintf(f,"#source\tline\tspec\ttarget\ttype\tdevice\n");
+    for(k=0;k<IN_KINDS;k++)
+    {
+        for(i=0,r=lists[k].rec;i<lists[k].n;i++,r++)
+        {
+            switch(fsspec_parse(r->spec,&fs))
+            {
+            case SPEC_OTHER:
+                dev="-";
+                break;
+            case SPEC_PATH:
+                val=fsspec_get(d,&fs,NULL);
+                dev= val ? val : memcmp(fs.key,"/dev/",5) ? "-" : fs.key;
+                break;
+            default:
+                dev=note(fsspec_get(d,&fs,(char *)fs.notfound));
+                break;
+            }
+            fprintf(f,"%s\t%d\t%s\t%s\t%s\t%s\n",r->source,r->line,r->spec,r->target,
+                    *r->type ? r->type : "-",dev);
+            free(r->source);
+            n++;
+        }
+        free(lists[k].rec);
+        memset(&lists[k],0,sizeof(lists[k]));
+    }
+    return n;
+}
@@ -0,0 +1,47 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    inputs.h
+   @author  Leslie Satenstein
+   @brief   Every mount configuration input annotated in one run (-a).
+
+   Besides the fstab, mounts and swaps are configured by
+       /etc/fstab.d/ *.fstab          fragments in fstab format
+       /etc/crypttab                  name  source  keyfile  options
+       .mount and .swap units         What= and Where= lines, from
+                                      /etc/systemd/system, /run/systemd/system
+                                      and /run/systemd/generator
+   inputs_start() reads them in parallel, one thread per kind of input,
+   while the caller runs discovery. inputs_report() waits for the readers
+   and writes one tab separated report, resolved with fsspec_parse()
+   against the one dictionary:
+       #source  line  spec  target  type  device
+   All paths are read under --root.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _INPUTS_H_
+#define _INPUTS_H_
+
+#include "dictionary.h"
+
+/**
+ * @brief inputs_start  Start reading the inputs
+ * @param fstab         the main fstab, listed first
+ * @return              0 if Ok, -1 if the readers could not be started
+ */
+int inputs_start(const char *fstab);
+
+/**
+ * @brief inputs_report  Wait for the readers and write the report
+ * @param f              output stream
+ * @param d              the dictionary
+ * @param note           formats the device column from a device name
+ * @return               number of entries reported
+ */
+int inputs_report(FILE *f, const dictionary *d, char *(*note)(const char *));
+
+#endif
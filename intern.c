@@ -0,0 +1,216 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    intern.c
+   @author  Leslie Satenstein
+   @brief   Process wide string intern table (see intern.h)
+
+   The strings are stored back to back in chunks, each one after its id
+   and padded to a multiple of 4 bytes, so intern_id() reads the word in
+   front of the string. An open addressing table, kept at most 3/4 full,
+   maps the hash to the id; the full hash is kept in the slot so that
+   strcmp() is only done on a likely match.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "intern.h"
+#include <string.h>
+
+#define CHUNK   65536                   /* bytes of string per chunk */
+
+struct chunk
+{
+    struct chunk *next;
+    size_t        used;
+    size_t        size;
+    unsigned      data[];               /* id, string, id, string ...  */
+};
+
+struct slot
+{
+    unsigned hash;
+    unsigned id1;                       /* id+1, 0 if empty            */
+};
+
+static struct chunk  *chunks;           /* the one being filled first  */
+static const char   **strs;             /* id to string                */
+static unsigned       nstr,strsize;
+static struct slot   *slots;
+static unsigned       mask;
+static size_t         chunkbytes,asked; /* for intern_stats()          */
+static unsigned long  calls;
+
+/*--------------------------------------------------------------------------*/
+unsigned intern_hash(const char *s, size_t len)
+{
+    unsigned h=intern_fnv(INTERN_FNV_BASIS,s,len);
+
+    h^=h>>16;
+    h*=0x85ebca6bu;
+    return h^(h>>13);
+}
+
+static struct slot *lookup(const char *s, size_t len, unsigned h)
+{
+    unsigned i;
+    const char *p;
+
+    if(slots==NULL)
+        return NULL;
+    for(i=h&mask; slots[i].id1; i=(i+1)&mask)
+        if(slots[i].hash==h)
+        {
+            p=strs[slots[i].id1-1];
+            if(!memcmp(p,s,len) && p[len]=='\0')
+                break;
+        }
+    return &slots[i];
+}
+
+static int rehash(void)
+{
+    struct slot *t;
+    unsigned m,i,k;
+
+    m= mask ? 2*mask+1 : 1023;
+    t=calloc(m+1,sizeof(struct slot));
+    if(t==NULL)
+        return -1;
+    for(k=0;k<=mask && slots!=NULL;k++)
+        if(slots[k].id1)
+        {
+            for(i=slots[k].hash&m; t[i].id1; i=(i+1)&m)
+                ;
+            t[i]=slots[k];
+        }
+    free(slots);
+    slots=t;
+    mask=m;
+    return 0;
+}
+
+/* room for an id and len+1 bytes, rounded up to whole words */
+static unsigned *place(size_t len)
+{
+    struct chunk *c;
+    size_t words=1+(len+sizeof(unsigned))/sizeof(unsigned);
+    size_t size;
+
+    if(chunks!=NULL && chunks->used+words<=chunks->size)
+    {
+        chunks->used+=words;
+        return chunks->data+chunks->used-words;
+    }
+    size= words*sizeof(unsigned)>CHUNK/4 ? words : CHUNK/sizeof(unsigned);
+    c=malloc(sizeof(struct chunk)+size*sizeof(unsigned));
+    if(c==NULL)
+        return NULL;
+    c->size=size;
+    c->used=words;
+    chunkbytes+=sizeof(struct chunk)+size*sizeof(unsigned);
+    if(chunks!=NULL && size==words)
+    {
+        c->next=chunks->next;           /* a long string has its own chunk */
+        chunks->next=c;
+    }
+    else
+    {
+        c->next=chunks;
+        chunks=c;
+    }
+    return c->data;
+}
+
+/*--------------------------------------------------------------------------*/
+const char *intern(const char *s)
+{
+    struct slot *sl;
+    size_t len;
+    unsigned h;
+    unsigned *w;
+    char *p;
+
+    if(s==NULL)
+        return NULL;
+    len=strlen(s);
+    h=intern_hash(s,len);
+
+    calls++;
+    asked+= len+9<32 ? 32 : (len+9+15)&~(size_t)15;   /* a glibc malloc() chunk */
+    sl=lookup(s,len,h);
+    if(sl!=NULL && sl->id1)
+        return strs[sl->id1-1];
+
+    if(4*(nstr+1)>3*mask)
+    {
+        if(rehash())
+            return NULL;
+        sl=lookup(s,len,h);
+    }
+    if(nstr==strsize)
+    {
+        const char **t=realloc(strs,(strsize ? 2*strsize : 1024)*sizeof(char *));
+
+        if(t==NULL)
+            return NULL;
+        strs=t;
+        strsize= strsize ? 2*strsize : 1024;
+    }
+    w=place(len);
+    if(w==NULL)
+        return NULL;
+    *w=nstr;
+    p=(char *)(w+1);
+    memcpy(p,s,len);
+    p[len]='\0';
+    strs[nstr]=p;
+    sl->hash=h;
+    sl->id1=++nstr;
+    return p;
+}
+
+const char *intern_find(const char *s, size_t len)
+{
+    struct slot *sl=lookup(s,len,intern_hash(s,len));
+
+    return sl!=NULL && sl->id1 ? strs[sl->id1-1] : NULL;
+}
+
+unsigned intern_id(const char *is)
+{
+    return ((const unsigned *)is)[-1];
+}
+
+const char *intern_str(unsigned id)
+{
+    return id<nstr ? strs[id] : NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+void intern_stats(FILE *f)
+{
+    size_t stored=chunkbytes+(mask+1)*sizeof(struct slot)+strsize*sizeof(char *);
+
+    fprintf(f,"interned %u strings in %zu KB, a strdup() for each of the %lu calls "
+            "would take %zu KB\n",nstr,stored/1024,calls,asked/1024);
+}
+
+void intern_free(void)
+{
+    struct chunk *c;
+
+    while((c=chunks)!=NULL)
+    {
+        chunks=c->next;
+        free(c);
+    }
+    free(strs);
+    free(slots);
+    strs=NULL;
+    slots=NULL;
+    nstr=strsize=mask=0;
+    chunkbytes=asked=0;
+    calls=0;
+}
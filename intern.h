@@ -0,0 +1,106 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    intern.h
+   @author  Leslie Satenstein
+   @brief   Process wide string intern table.
+
+   A UUID read by the discovery code used to be copied by every
+   dictionary_set() that stored it, once per namespace, and a device name
+   such as sdb7 once for every alias key pointing at it. intern() returns
+   the one copy of a string: equal strings give the same pointer, so two
+   interned strings are equal when their pointers are.
+
+   Each string also gets an id, numbered from 0 in the order strings are
+   first seen. Pointers and ids stay valid until intern_free(): the bytes
+   live in 64 KB chunks that are never moved, and nothing is removed one
+   string at a time. The dictionary keeps its keys and values here, and
+   mntopt the options the keyword table does not know. fsspec_parse()
+   only looks its keys up with intern_find(), so probes for keys nobody
+   holds do not grow the table. Interned bytes are shared and must not
+   be written to.
+
+   intern_fnv() is the one FNV-1a string hash of the program, under
+   intern_hash(), the keyword table of mntopt.c and mkoptkeys.c and the
+   joins of fstabdiff.c.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INTERN_FNV_BASIS 2166136261u
+
+/**
+ * @brief intern_fnv  FNV-1a of the len bytes at p, continuing from h;
+ *                    INTERN_FNV_BASIS to start
+ */
+static inline unsigned intern_fnv(unsigned h, const void *p, size_t len)
+{
+    const unsigned char *s=(const unsigned char *)p;
+
+    while(len--)
+        h=(h^*s++)*16777619u;
+    return h;
+}
+
+/**
+ * @brief intern_hash  intern_fnv() of the len bytes at s with a final mix,
+ *                     so that the low bits can index a table
+ */
+unsigned intern_hash(const char *s, size_t len);
+
+/**
+ * @brief intern    The shared copy of s, added if new
+ * @return          NULL if out of memory
+ */
+const char *intern(const char *s);
+
+/**
+ * @brief intern_find  The shared copy of the len bytes at s
+ * @return             NULL if that string was never interned, in which
+ *                     case no dictionary holds it as key or value
+ */
+const char *intern_find(const char *s, size_t len);
+
+/**
+ * @brief intern_id  Id of an interned string
+ * @param is         a pointer returned by intern(), not merely equal text
+ */
+unsigned intern_id(const char *is);
+
+/**
+ * @brief intern_str  The interned string of an id
+ * @return            NULL if id was not given out
+ */
+const char *intern_str(unsigned id);
+
+/**
+ * @brief intern_stats  Print the number of strings and the bytes they
+ *                      take, tables included, against what a strdup() per
+ *                      call would have taken from malloc()
+ */
+void intern_stats(FILE *f);
+
+/**
+ * @brief intern_free  Release every interned string. All pointers given
+ *                     out become invalid, so this is for the end of main().
+ */
+void intern_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
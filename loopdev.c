@@ -0,0 +1,180 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    loopdev.c
+   @author  Leslie Satenstein
+   @brief   Loop device and file backed entry resolution (see loopdev.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE             /* statx() */
+#include "loopdev.h"
+#include "sysroot.h"
+#include "fsspec.h"
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define FILEDEV_MAX 1024        /* paths pre-scanned from one fstab */
+
+/*--------------------------------------------------------------------------*/
+/* first line of a sysfs file, trailing blanks removed                     */
+static int sysfs_line(const char *path, char *buf, size_t size)
+{
+    FILE *f;
+    int len;
+
+    f=sysroot_fopen(path);
+    if(f==NULL)
+        return -1;
+    if(fgets(buf,size,f)==NULL)
+    {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    len=strlen(buf);
+    while(len>0 && buf[len-1]<=' ')
+        buf[--len]='\0';
+    return len;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief loopdev_fill  Backing file and offset of each attached loop device
+ */
+/*--------------------------------------------------------------------------*/
+int loopdev_fill(dictionary *d)
+{
+    sysdir *dir;
+    struct dirent *de;
+    char path[PATH_MAX];
+    char backing[PATH_MAX];
+    char offset[32];
+    char key[NAME_MAX+16];
+    char val[PATH_MAX+40];
+    int  n=0;
+
+    dir=sysroot_opendir("/sys/block");
+    if(dir==NULL)
+        return 0;
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(memcmp(de->d_name,"loop",4))
+            continue;
+        snprintf(path,sizeof(path),"/sys/block/%s/loop/backing_file",de->d_name);
+        if(sysfs_line(path,backing,sizeof(backing))<=0)
+            continue;                   /* not attached */
+        snprintf(path,sizeof(path),"/sys/block/%s/loop/offset",de->d_name);
+        if(sysfs_line(path,offset,sizeof(offset))>0 && strcmp(offset,"0"))
+            snprintf(val,sizeof(val),"%s@%s",backing,offset);
+        else
+            snprintf(val,sizeof(val),"%s",backing);
+        snprintf(key,sizeof(key),"LOOPDEV=%s",de->d_name);
+        dictionary_set(d,key,val);      /* tagged, LABEL=loop0 is keyed loop0 */
+        snprintf(val,sizeof(val),"LOOP=%s",backing);
+        dictionary_set(d,val,de->d_name);
+        debug("%s backed by %s\n",de->d_name,backing);
+        n++;
+    }
+    sysroot_closedir(dir);
+    return n;
+}
+
+/*--------------------------------------------------------------------------*/
+/* Annotation for one path, given its statx() result                       */
+static void filedev_one(dictionary *d, const devtable *t, const char *path, const struct statx *stx)
+{
+    char  val[PATH_MAX*2];
+    char  key[PATH_MAX+8];
+    const char *dev;
+    char *loop;
+    char *backing;
+
+    if(S_ISBLK(stx->stx_mode))
+    {
+        dev=devtable_name(t,stx->stx_rdev_major,stx->stx_rdev_minor);
+        if(dev==NULL || memcmp(dev,"loop",4))
+            return;                     /* a plain /dev/sdX needs no note */
+        snprintf(key,sizeof(key),"LOOPDEV=%s",dev);
+        backing=dictionary_get(d,key,NULL);
+        if(backing==NULL)
+            return;
+        snprintf(val,sizeof(val),"/dev/%s=%s",dev,backing);
+    }
+    else if(S_ISREG(stx->stx_mode))
+    {
+        dev=devtable_name(t,stx->stx_dev_major,stx->stx_dev_minor);
+        snprintf(key,sizeof(key),"LOOP=%s",path);
+        loop=dictionary_get(d,key,NULL);
+        if(loop!=NULL && dev!=NULL)
+            snprintf(val,sizeof(val),"/dev/%s (on /dev/%s)",loop,dev);
+        else if(loop!=NULL)
+            snprintf(val,sizeof(val),"/dev/%s",loop);
+        else if(dev!=NULL)
+            snprintf(val,sizeof(val),"/dev/%s",dev);
+        else
+            return;
+    }
+    else
+        return;
+    debug("%s -> %s\n",path,val);
+    dictionary_set(d,path,val);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief filedev_fill  Batch statx() of the path sources of fstab
+ */
+/*--------------------------------------------------------------------------*/
+int filedev_fill(dictionary *d, const devtable *t, const char *fstab)
+{
+    FILE  *f;
+    char   line[PATH_MAX];
+    char   spec[PATH_MAX];
+    char  *paths[FILEDEV_MAX];
+    struct statx *stx;
+    int    npath=0;
+    int    n=0;
+    int    i;
+
+    f=sysroot_fopen(fstab);
+    if(f==NULL)
+        return 0;
+    /* pass 1: collect the path sources */
+    while(npath<FILEDEV_MAX && fgets(line,sizeof(line),f)!=NULL)
+    {
+        if(sscanf(line,"%s",spec)!=1 || *spec!='/')
+            continue;
+        fsspec_decode(spec);            /* keyed as fsspec_parse() looks it up */
+        paths[npath]=strdup(spec);
+        if(paths[npath]!=NULL)
+            npath++;
+    }
+    fclose(f);
+    if(npath==0)
+        return 0;
+
+    /* pass 2: one statx() per path, no sync with remote filesystems */
+    stx=calloc(npath,sizeof(struct statx));
+    if(stx==NULL)
+        exit(-1);
+    for(i=0;i<npath;i++)
+        if(sysroot_statx(paths[i],&stx[i]))
+            stx[i].stx_mode=0;
+
+    /* pass 3: device names, two array loads each */
+    for(i=0;i<npath;i++)
+    {
+        if(stx[i].stx_mode!=0)
+        {
+            filedev_one(d,t,paths[i],&stx[i]);
+            n++;
+        }
+        free(paths[i]);
+    }
+    free(stx);
+    return n;
+}
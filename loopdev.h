@@ -0,0 +1,50 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    loopdev.h
+   @author  Leslie Satenstein
+   @brief   Annotation of file backed fstab entries: loop devices, swap
+            files and image files.
+
+   loopdev_fill() reads /sys/block/loopN/loop/backing_file and offset.
+   filedev_fill() takes the first column of every fstab line that is a
+   path, stat()s them in one batch with statx() and stores, for each path,
+   the annotation that fstabToDictMatch() prints:
+       /dev/loop0          ->  /dev/loop0=/srv/images/a.img@1048576
+       /swapfile           ->  /dev/sda2
+       /srv/images/a.img   ->  /dev/loop0 (on /dev/sda2)
+   Device numbers are turned into names through the major:minor table of
+   devtable.h, so the dictionary holds no "MAJ:MIN" keys. No external
+   command is run.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _LOOPDEV_H_
+#define _LOOPDEV_H_
+
+#include "dictionary.h"
+#include "devtable.h"
+
+/**
+ * @brief loopdev_fill  Store the backing file of every attached loop device
+ *                      keys: "LOOP=<backing file>" -> "loopN"
+ *                            "LOOPDEV=loopN"       -> "<backing file>[@offset]"
+ * @param d             the dictionary
+ * @return              number of attached loop devices
+ */
+int loopdev_fill(dictionary *d);
+
+/**
+ * @brief filedev_fill  Resolve every path in the first column of fstab
+ *                      and store key=path, val=annotation
+ * @param d             the dictionary, after loopdev_fill()
+ * @param t             the device number table, after devtable_load()
+ * @param fstab         the fstab to pre-scan
+ * @return              number of paths resolved
+ */
+int filedev_fill(dictionary *d, const devtable *t, const char *fstab);
+
+#endif
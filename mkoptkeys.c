@@ -0,0 +1,108 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    mkoptkeys.c
+   @author  Leslie Satenstein
+   @brief   Build time generator of the mount option keyword table.
+
+   mkoptkeys optkeys.txt > obj/optkeys.h
+
+   Reads the keyword list and searches for a seed of the FNV-1a hash that
+   puts every keyword in its own slot of a table of OPTKEY_SLOTS slots,
+   a power of two at least four times the number of keywords. The header
+   written holds the keywords in file order and the slot to keyword
+   table; mntopt.c looks a word up with one hash and one strcmp(). A
+   group of - is written as "", the option stands alone.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+#define MAXKEYS 1024
+
+struct key
+{
+    char name[64];
+    char group[64];
+    int  dflt;
+    char fstype[32];
+};
+
+static struct key keys[MAXKEYS];
+static int        slot[4*MAXKEYS];
+
+/* must match optkey_hash() in mntopt.c                                    */
+static unsigned hash(const char *s, size_t len, unsigned seed)
+{
+    unsigned h=intern_fnv(INTERN_FNV_BASIS^seed,s,len);
+
+    return h^(h>>15);
+}
+
+int main(int argc, char *argv[])
+{
+    char line[512];
+    FILE *f;
+    unsigned seed,size,i;
+    int n=0,k,ok=0;
+
+    if(argc!=2 || (f=fopen(argv[1],"r"))==NULL)
+    {
+        fprintf(stderr,"usage: %s optkeys.txt > optkeys.h\n",argv[0]);
+        return 1;
+    }
+    while(fgets(line,sizeof(line),f)!=NULL)
+    {
+        if(*line=='#' || sscanf(line,"%63s %63s %d %31s",keys[n].name,keys[n].group,
+                                &keys[n].dflt,keys[n].fstype)!=4)
+            continue;
+        for(k=0;k<n;k++)
+            if(!strcmp(keys[k].name,keys[n].name))
+            {
+                fprintf(stderr,"%s: %s is listed twice\n",argv[1],keys[n].name);
+                return 1;
+            }
+        if(++n==MAXKEYS)
+            break;
+    }
+    fclose(f);
+
+    for(size=16; size<4u*n; size<<=1)
+        ;
+    for(seed=1; seed<1000000 && !ok; seed++)
+    {
+        memset(slot,-1,size*sizeof(int));
+        for(ok=1,k=0; k<n && ok; k++)
+        {
+            i=hash(keys[k].name,strlen(keys[k].name),seed)&(size-1);
+            if(slot[i]>=0)
+                ok=0;
+            slot[i]=k;
+        }
+    }
+    if(!ok)
+    {
+        fprintf(stderr,"%s: no perfect hash found\n",argv[1]);
+        return 1;
+    }
+    seed--;
+
+    printf("/* generated by mkoptkeys from %s, do not edit */\n\n",argv[1]);
+    printf("#define OPTKEY_SEED  %uu\n",seed);
+    printf("#define OPTKEY_SLOTS %u\n",size);
+    printf("#define OPTKEY_COUNT %d\n\n",n);
+    printf("static const struct optkey optkeys[OPTKEY_COUNT]=\n{\n");
+    for(k=0;k<n;k++)
+        printf("    { \"%s\", \"%s\", %d, \"%s\" },\n",keys[k].name,
+               strcmp(keys[k].group,"-") ? keys[k].group : "",keys[k].dflt,keys[k].fstype);
+    printf("};\n\nstatic const short optslot[OPTKEY_SLOTS]=\n{");
+    for(i=0;i<size;i++)
+        printf("%s%3d,",i%16 ? " " : "\n    ",slot[i]);
+    printf("\n};\n");
+    return 0;
+}
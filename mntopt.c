@@ -0,0 +1,261 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    mntopt.c
+   @author  Leslie Satenstein
+   @brief   Canonical interned mount options (see mntopt.h)
+
+   An option not in the keyword table is interned (intern.h) and its atom
+   is OPTKEY_COUNT plus the intern id. Sets are found through an open
+   addressing table of atom array to set number, kept at most half full
+   and grown by doubling.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "mntopt.h"
+#include "optkeys.h"                    /* generated, see mkoptkeys.c */
+#include "intern.h"
+
+struct optset
+{
+    int  *atom;
+    int   n;
+    char *canon;
+};
+
+static struct optset *sets;
+static int      nset,setsize;
+static int     *setslot;                /* hash to set+1, 0 if empty */
+static unsigned setmask;
+
+/*--------------------------------------------------------------------------*/
+/* realloc(), exits when out of memory                                     */
+static void *grow(void *p, size_t size)
+{
+    p=realloc(p,size);
+    if(p==NULL)
+        exit(-1);
+    return p;
+}
+
+/*--------------------------------------------------------------------------*/
+/* as in mkoptkeys.c                                                      */
+static unsigned optkey_hash(const char *s, size_t len, unsigned seed)
+{
+    unsigned h=intern_fnv(INTERN_FNV_BASIS^seed,s,len);
+
+    return h^(h>>15);
+}
+
+static unsigned atoms_hash(const int *a, int n)
+{
+    unsigned h=intern_fnv(INTERN_FNV_BASIS,a,n*sizeof(int));
+
+    return h^(h>>15);
+}
+
+/*-------------------------------------------------------------------------*/
+int mntopt_keyword(const char *s, size_t len)
+{
+    int k;
+
+    k=optslot[optkey_hash(s,len,OPTKEY_SEED)&(OPTKEY_SLOTS-1)];
+    if(k<0 || strncmp(optkeys[k].name,s,len) || optkeys[k].name[len]!='\0')
+        return -1;
+    return k;
+}
+
+/*-------------------------------------------------------------------------*/
+int mntopt_fstype(const char *type)
+{
+    int k;
+
+    k=mntopt_keyword(type,strlen(type));
+    return k>=0 && !strcmp(optkeys[k].group,"@fstype") ? k : -1;
+}
+
+/*-------------------------------------------------------------------------*/
+static const char *atom_name(int atom)
+{
+    return atom<OPTKEY_COUNT ? optkeys[atom].name : intern_str(atom-OPTKEY_COUNT);
+}
+
+int mntopt_atom(const char *opt)
+{
+    const char *is;
+    int a;
+
+    a=mntopt_keyword(opt,strlen(opt));
+    if(a>=0)
+        return a;
+    is=intern(opt);
+    if(is==NULL)
+        exit(-1);
+    return OPTKEY_COUNT+(int)intern_id(is);
+}
+
+/*--------------------------------------------------------------------------*/
+/* the set of atoms a, sorted by name, added if new                        */
+static int set_intern(const int *a, int n)
+{
+    size_t len=1;
+    unsigned i;
+    int s,k;
+
+    if(2*(nset+1)>(int)setmask)
+    {
+        free(setslot);
+        setmask= setmask ? 2*setmask+1 : 255;
+        setslot=calloc(setmask+1,sizeof(int));
+        if(setslot==NULL)
+            exit(-1);
+        for(s=0;s<nset;s++)
+        {
+            for(i=atoms_hash(sets[s].atom,sets[s].n)&setmask; setslot[i]; i=(i+1)&setmask)
+                ;
+            setslot[i]=s+1;
+        }
+    }
+    for(i=atoms_hash(a,n)&setmask; setslot[i]; i=(i+1)&setmask)
+    {
+        s=setslot[i]-1;
+        if(sets[s].n==n && !memcmp(sets[s].atom,a,n*sizeof(int)))
+            return s;
+    }
+    if(nset==setsize)
+    {
+        setsize= setsize ? 2*setsize : 64;
+        sets=grow(sets,setsize*sizeof(struct optset));
+    }
+    sets[nset].atom=grow(NULL,(n+1)*sizeof(int));
+    memcpy(sets[nset].atom,a,n*sizeof(int));
+    sets[nset].n=n;
+    for(k=0;k<n;k++)
+        len+=strlen(atom_name(a[k]))+1;
+    sets[nset].canon=grow(NULL,len);
+    *sets[nset].canon='\0';
+    for(k=0;k<n;k++)
+    {
+        if(k)
+            strcat(sets[nset].canon,",");
+        strcat(sets[nset].canon,atom_name(a[k]));
+    }
+    setslot[i]=++nset;
+    return nset-1;
+}
+
+static int by_name(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a,*(char * const *)b);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief mntopt_set  Split, keep the last of each group, drop the
+ *                    defaults, sort, intern
+ */
+/*--------------------------------------------------------------------------*/
+int mntopt_set(const char *opts, const char *fstype)
+{
+    char  *buf,*cp,*eq;
+    char **tok;
+    const char **grp;
+    size_t *glen;
+    const char *ft;
+    int   *atom;
+    int    n=0,m=0;
+    int    inq=0;
+    int    i,j,k,ftk,set;
+
+    buf=strdup(opts);
+    if(buf==NULL)
+        exit(-1);
+    for(cp=buf,i=1; *cp; cp++)          /* room for the tokens */
+        i+= *cp==',';
+    tok=grow(NULL,i*sizeof(char *));
+    grp=grow(NULL,i*sizeof(char *));
+    glen=grow(NULL,i*sizeof(size_t));
+    atom=grow(NULL,i*sizeof(int));
+    ftk=mntopt_fstype(fstype);
+
+    for(cp=buf; cp!=NULL; )
+    {
+        tok[n]=cp;
+        for(; *cp && (inq || *cp!=','); cp++)
+            if(*cp=='"')
+                inq=!inq;
+        if(*cp==',')
+            *cp++='\0';
+        else
+            cp=NULL;
+        if(*tok[n]=='\0')
+            continue;
+        eq=strchr(tok[n],'=');
+        k=mntopt_keyword(tok[n],strlen(tok[n]));
+        if(k<0 && eq!=NULL)
+            k=mntopt_keyword(tok[n],eq-tok[n]);
+        grp[n]=tok[n];                  /* alone, only duplicates go */
+        glen[n]=strlen(tok[n]);
+        if(k>=0 && *optkeys[k].group)
+        {
+            grp[n]=optkeys[k].group;
+            glen[n]=strlen(grp[n]);
+        }
+        else if(k<0 && eq!=NULL)
+            glen[n]=eq-tok[n];          /* size=1G: the group is size */
+        for(j=0;j<n && (glen[j]!=glen[n] || strncmp(grp[j],grp[n],glen[n]));j++)
+            ;
+        if(j<n)
+            tok[j]=tok[n];              /* the last one wins */
+        else
+            n++;
+    }
+
+    for(i=0;i<n;i++)
+    {
+        k=mntopt_keyword(tok[i],strlen(tok[i]));
+        if(k>=0 && optkeys[k].dflt)
+        {
+            ft=optkeys[k].fstype;
+            if(*ft=='*' || (ftk>=0 && !strncmp(optkeys[ftk].name,ft,strlen(ft))))
+                continue;               /* what happens anyway */
+        }
+        tok[m++]=tok[i];
+    }
+    qsort(tok,m,sizeof(char *),by_name);
+    for(i=0;i<m;i++)
+        atom[i]=mntopt_atom(tok[i]);
+    set=set_intern(atom,m);
+    free(buf);
+    free(tok);
+    free(grp);
+    free(glen);
+    free(atom);
+    return set;
+}
+
+/*-------------------------------------------------------------------------*/
+const char *mntopt_canon(int set)
+{
+    return set>=0 && set<nset ? sets[set].canon : "";
+}
+
+/*-------------------------------------------------------------------------*/
+void mntopt_free(void)
+{
+    int i;
+
+    for(i=0;i<nset;i++)
+    {
+        free(sets[i].atom);
+        free(sets[i].canon);
+    }
+    free(sets);
+    free(setslot);
+    sets=NULL;
+    setslot=NULL;
+    nset=setsize=0;
+    setmask=0;
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    mntopt.h
+   @author  Leslie Satenstein
+   @brief   Mount options as interned, canonical sets.
+
+   The options field is split on commas (not inside quotes, for SELinux
+   contexts) and brought to a canonical form:
+       options of one group override each other, the last one wins
+           ro,rw -> rw       size=1G,size=2G -> size=2G
+       what the kernel does anyway is left out
+           defaults,rw,relatime,noatime -> noatime
+       data=ordered only for ext4, inode64 only for xfs ...
+       the rest sorted
+   Known options and filesystem types are found in a perfect hash table
+   generated at build time from optkeys.txt by mkoptkeys. Every option
+   string gets an integer, the keyword number or, for options the table
+   does not know, one past it plus the id of intern.h. A canonical set of
+   those integers gets an integer in turn, so entries with the same
+   effective options share one set number; grouping by options is a
+   hash of integers.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MNTOPT_H_
+#define _MNTOPT_H_
+
+#include "dictionary.h"
+
+struct optkey
+{
+    const char *name;           /** noatime, data=ordered, ext4           */
+    const char *group;          /** options that override each other, ""  */
+    int         dflt;           /** 1 if left out of the canonical form   */
+    const char *fstype;         /** the filesystem it belongs to, or "*"  */
+};
+
+/**
+ * @brief mntopt_keyword  Look up a keyword in the generated table
+ * @param s               the word, not NUL terminated
+ * @param len             its length
+ * @return                keyword number, -1 if unknown
+ */
+int mntopt_keyword(const char *s, size_t len);
+
+/**
+ * @brief mntopt_fstype  Keyword number of a filesystem type, -1 if unknown
+ */
+int mntopt_fstype(const char *type);
+
+/**
+ * @brief mntopt_atom  Intern one option string
+ * @return             its number, stable for the life of the process
+ */
+int mntopt_atom(const char *opt);
+
+/**
+ * @brief mntopt_set  Intern the canonical set of an options field
+ * @param opts        the options field
+ * @param fstype      the filesystem type, for per type defaults
+ * @return            set number, equal for equal effective options
+ */
+int mntopt_set(const char *opts, const char *fstype);
+
+/**
+ * @brief mntopt_canon  The canonical text of a set, "" for the defaults
+ */
+const char *mntopt_canon(int set);
+
+/**
+ * @brief mntopt_free  Free the sets; interned options stay until
+ *                     intern_free()
+ */
+void mntopt_free(void);
+
+#endif
@@ -0,0 +1,169 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    mounttab.c
+   @author  Leslie Satenstein
+   @brief   Resolved fstab entries and path queries (see mounttab.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "mounttab.h"
+#include "fsspec.h"
+#include "sysroot.h"
+#include <limits.h>
+
+/*--------------------------------------------------------------------------*/
+int mounttab_opt(const char *opts, const char *opt)
+{
+    size_t len=strlen(opt);
+    const char *cp;
+
+    for(cp=opts; cp!=NULL; cp=strchr(cp,','))
+    {
+        if(*cp==',')
+            cp++;
+        if(!strncmp(cp,opt,len) && (cp[len]==',' || cp[len]=='\0'))
+            return 1;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+void mounttab_dev(const dictionary *d, const char *spec, char *dev, size_t size)
+{
+    struct fsspec fs;
+    char  link[PATH_MAX];
+    const char *name=NULL;
+
+    *dev='\0';
+    switch(fsspec_parse(spec,&fs))
+    {
+    case SPEC_OTHER:
+        return;
+    case SPEC_PATH:
+        if(memcmp(fs.key,"/dev/",5))
+            return;                     /* a file or a bind source */
+        if(sysroot_readlink(fs.key,link,sizeof(link))>0)   /* /dev/mapper/x */
+            name=strrchr(link,'/') ? strrchr(link,'/')+1 : link;
+        else
+            name=strrchr(fs.key,'/')+1;
+        break;
+    default:
+        name=fsspec_get(d,&fs,NULL);
+        break;
+    }
+    if(name!=NULL)
+        snprintf(dev,size,"%.31s",name);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief mounttab_load  One entry per fstab line, then the trie
+ */
+/*--------------------------------------------------------------------------*/
+mounttab *mounttab_load(const dictionary *d, const char *fstab, int flags)
+{
+    char  line[PATH_MAX];
+    struct mountent e,*m;
+    mounttab *mt;
+    FILE *f;
+    void *p;
+    int   lineno=0;
+    int   dump;
+    int   i,n;
+
+    f=sysroot_fopen(fstab);
+    if(f==NULL)
+        return NULL;
+    mt=calloc(1,sizeof(mounttab));
+    if(mt==NULL || (mt->trie=pathtrie_new())==NULL)
+        exit(-1);
+    while(fgets(line,sizeof(line),f)!=NULL)
+    {
+        lineno++;
+        memset(&e,0,sizeof(e));
+        n=sscanf(line," %4095s %4095s %63s %4095s %d %d",e.spec,e.where,e.type,e.opts,
+                 &dump,&e.pass);
+        if(n<4 || *e.spec=='#')
+            continue;
+        if(n<6)
+            e.pass=0;                   /* no pass field, or not a number */
+        if(!(flags&MT_NOAUTO) && mounttab_opt(e.opts,"noauto"))
+            continue;
+        if(mt->n==mt->size)
+        {
+            mt->size= mt->size ? 2*mt->size : 64;
+            p=realloc(mt->ent,mt->size*sizeof(struct mountent));
+            if(p==NULL)
+                exit(-1);
+            mt->ent=p;
+        }
+        m=&mt->ent[mt->n];
+        *m=e;
+        m->line=lineno;
+        if(!strcmp(m->type,"swap") || *m->where!='/')
+            *m->where='\0';             /* swap, no place in the tree */
+        else
+        {
+            fsspec_decode(m->where);
+            pathtrie_add(mt->trie,m->where,mt->n);
+        }
+        mounttab_dev(d,m->spec,m->dev,sizeof(m->dev));
+        if(*m->dev!='\0' && (flags&MT_DISKS))
+        {
+            m->ndisk=devgraph_disks(m->dev,m->disk,DEVGRAPH_MAX);
+            for(i=0;i<m->ndisk;i++)
+                if(devgraph_rotational(m->disk[i])!=0)  /* unknown counts as spinning */
+                    m->spin|=1u<<i;
+        }
+        mt->n++;
+    }
+    fclose(f);
+    return mt;
+}
+
+/*-------------------------------------------------------------------------*/
+int mounttab_find(const mounttab *mt, const char *path)
+{
+    return pathtrie_lpm(mt->trie,path,0);
+}
+
+/*-------------------------------------------------------------------------*/
+int mounttab_query(FILE *out, FILE *in, const mounttab *mt)
+{
+    char line[PATH_MAX];
+    const struct mountent *m;
+    int  n=0;
+    int  i;
+
+    while(fgets(line,sizeof(line),in)!=NULL)
+    {
+        line[strcspn(line,"\r\n")]='\0';
+        if(*line=='\0')
+            continue;
+        n++;
+        i=mounttab_find(mt,line);
+        if(i<0)
+        {
+            fprintf(out,"%s\t-\t-\t-\n",line);
+            continue;
+        }
+        m=&mt->ent[i];
+        fprintf(out,"%s\t%s\t%s\t%s\n",line,m->where,m->spec,*m->dev ? m->dev : "-");
+    }
+    fflush(out);
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+void mounttab_del(mounttab **mt)
+{
+    if(mt==NULL || *mt==NULL)
+        return;
+    pathtrie_del(&(*mt)->trie);
+    free((*mt)->ent);
+    free(*mt);
+    *mt=NULL;
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    mounttab.h
+   @author  Leslie Satenstein
+   @brief   The fstab entries, resolved to their devices, with a mountpoint
+            trie for path queries.
+
+   mounttab_load() reads the fstab (under --root), resolves every spec to
+   its device name through the dictionary and, when asked, the device to
+   the whole disks under it. The mountpoints go into a compressed path
+   trie (pathtrie.h), so the entry backing a path is one trie walk:
+       /srv/pg/data/base/16384  ->  /srv/pg  UUID=...  sdc1
+   A repeated mountpoint is answered with the last entry, the one mounted
+   on top. Swap entries have no mountpoint.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MOUNTTAB_H_
+#define _MOUNTTAB_H_
+
+#include "dictionary.h"
+#include "devgraph.h"
+#include "pathtrie.h"
+#include <limits.h>
+
+#define MOUNTTAB_FIELD PATH_MAX         /* a whole fstab line fits one field */
+
+struct mountent
+{
+    char spec[MOUNTTAB_FIELD];
+    char where[MOUNTTAB_FIELD];         /** decoded, "" for swap */
+    char type[64];
+    char opts[MOUNTTAB_FIELD];
+    char dev[32];                       /** sdb2, dm-3, "" if none */
+    char disk[DEVGRAPH_MAX][32];        /** whole disks under dev */
+    int  ndisk;
+    unsigned spin;                      /** bit i set, disk[i] is rotational */
+    int  pass;                          /** sixth field, fsck order, 0 if absent */
+    int  line;                          /** line number in the fstab */
+};
+
+typedef struct _mounttab_
+{
+    struct mountent *ent;
+    int              n,size;
+    pathtrie        *trie;              /** mountpoint to entry number */
+} mounttab;
+
+#define MT_NOAUTO 1                     /* keep the noauto entries */
+#define MT_DISKS  2                     /* find the disks under each device */
+
+/**
+ * @brief mounttab_load  Read and resolve the fstab
+ * @param d              the dictionary, spec to device name
+ * @param fstab          the fstab, read under --root
+ * @param flags          MT_NOAUTO, MT_DISKS
+ * @return               the table, NULL if fstab can not be read
+ */
+mounttab *mounttab_load(const dictionary *d, const char *fstab, int flags);
+
+/**
+ * @brief mounttab_find  The entry whose mountpoint holds path
+ * @return               entry number, -1 if no mountpoint is a prefix
+ */
+int mounttab_find(const mounttab *mt, const char *path);
+
+/**
+ * @brief mounttab_opt  Option opt in the comma list opts
+ */
+int mounttab_opt(const char *opts, const char *opt);
+
+/**
+ * @brief mounttab_dev  The device name for a spec: sdb2, dm-3, or "" for
+ *                      nfs, tmpfs, bind sources ...
+ */
+void mounttab_dev(const dictionary *d, const char *spec, char *dev, size_t size);
+
+/**
+ * @brief mounttab_query  Answer one path per line of in on out:
+ *                        path  mount  spec  device  (tab separated)
+ * @return                number of paths answered
+ */
+int mounttab_query(FILE *out, FILE *in, const mounttab *mt);
+
+/**
+ * @brief mounttab_del  Free the table and set *mt to NULL
+ */
+void mounttab_del(mounttab **mt);
+
+#endif
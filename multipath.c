@@ -0,0 +1,254 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    multipath.c
+   @author  Leslie Satenstein
+   @brief   WWID based grouping of block devices (see multipath.h)
+
+   The LUN table is itself a small dictionary:
+       key = device name (sdq, sdq3, dm-4, mpathc, mpathc3)
+       val = "R group#part"
+   where R is the rank of the device ('2' multipath, '1' sd path),
+   group is the normalized WWID and part the partition number (0 for
+   the whole LUN). Two devices are paths to the same thing when the
+   text following the rank is identical.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "multipath.h"
+#include "uuid.h"
+#include "intern.h"
+#include "sysroot.h"
+#include <dirent.h>
+#include <limits.h>
+#include <ctype.h>
+#include <libgen.h>
+
+#define SYSBLOCK "/sys/class/block"
+
+static dictionary *lun=NULL;       /* device name -> "rank wwid#part" */
+
+/*--------------------------------------------------------------------------*/
+/* read the first line of /sys/class/block/<dev>/<attr>, trailing blanks  */
+/* removed. Returns the length read or -1                                  */
+static int sysfs_read(const char *dev, const char *attr, char *buf, size_t size)
+{
+    char path[PATH_MAX];
+    FILE *f;
+    int  len;
+
+    snprintf(path,sizeof(path),SYSBLOCK "/%s/%s",dev,attr);
+    f=sysroot_fopen(path);
+    if(f==NULL)
+        return -1;
+    if(fgets(buf,size,f)==NULL)
+    {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    len=strlen(buf);
+    while(len>0 && buf[len-1]<=' ')
+        buf[--len]='\0';
+    return len;
+}
+
+/*--------------------------------------------------------------------------*/
+/* The sysfs wwid ("naa.600508b1...") and the multipath uuid               */
+/* ("mpath-3600508b1...") spell the same id differently. Convert the sysfs */
+/* form to the scsi_id form used by multipathd: a type digit then the id.  */
+static void wwid_normalize(const char *in, char *out, size_t size)
+{
+    size_t j=0;
+
+    if(!memcmp(in,"naa.",4))
+        out[j++]='3';
+    else if(!memcmp(in,"eui.",4))
+        out[j++]='2';
+    else if(!memcmp(in,"t10.",4))
+        out[j++]='1';
+    if(j)
+        in+=4;
+    for( ; *in!='\0' && j<size-1; in++)
+        out[j++]= (*in==' ') ? '_' : tolower((unsigned char)*in);
+    out[j]='\0';
+}
+
+/*--------------------------------------------------------------------------*/
+/* record dev as rank/group/part. An existing sd entry is only replaced    */
+/* when force is set (slaves/ of a multipath map are authoritative)        */
+static void lun_add(const char *dev, int rank, const char *group, int part, int force)
+{
+    char val[PATH_MAX];
+
+    if(!force && dictionary_get(lun,dev,NULL)!=NULL)
+        return;
+    snprintf(val,sizeof(val),"%d %s#%d",rank,group,part);
+    debug("lun %s = %s\n",dev,val);
+    dictionary_set(lun,dev,val);
+}
+
+/*--------------------------------------------------------------------------*/
+/* dm devices are listed by lsblk under their map name (mpatha1) and under */
+/* /dev/disk/by-* as dm-N. Register both.                                   */
+static void lun_add_dm(const char *dev, const char *group, int part)
+{
+    char name[NAME_MAX+1];
+
+    lun_add(dev,2,group,part,1);
+    if(sysfs_read(dev,"dm/name",name,sizeof(name))>0)
+        lun_add(name,2,group,part,1);
+}
+
+/*--------------------------------------------------------------------------*/
+static void lun_slaves(const char *dev, const char *group)
+{
+    char path[PATH_MAX];
+    sysdir *dir;
+    struct dirent *de;
+
+    snprintf(path,sizeof(path),SYSBLOCK "/%s/slaves",dev);
+    dir=sysroot_opendir(path);
+    if(dir==NULL)
+        return;
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(*de->d_name=='.')
+            continue;
+        lun_add(de->d_name,1,group,0,1);
+    }
+    sysroot_closedir(dir);
+}
+
+/*--------------------------------------------------------------------------*/
+/* A partition inherits the group of its parent disk. The parent is the    */
+/* directory containing the partition in the sysfs link target.           */
+static void lun_partition(const char *dev)
+{
+    char path[PATH_MAX];
+    char real[PATH_MAX];
+    char attr[32];
+    char *pval;
+    char group[PATH_MAX];
+    char *hash;
+    int  part;
+
+    if(sysfs_read(dev,"partition",attr,sizeof(attr))<=0)
+        return;
+    part=atoi(attr);
+    snprintf(path,sizeof(path),SYSBLOCK "/%s",dev);
+    if(sysroot_readlink(path,real,sizeof(real))<=0)
+        return;
+    pval=dictionary_get(lun,basename(dirname(real)),NULL);
+    if(pval==NULL)
+        return;
+    strcpy(group,pval+2);
+    hash=strrchr(group,'#');
+    if(hash)
+        *hash='\0';
+    lun_add(dev,*pval-'0',group,part,0);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief multipath_load  Build the device to LUN table from sysfs
+ * @return                number of grouped devices
+ */
+/*--------------------------------------------------------------------------*/
+int multipath_load(void)
+{
+    sysdir *dir;
+    struct dirent *de;
+    char uuid[PATH_MAX];
+    char wwid[PATH_MAX];
+    char *cp;
+
+    multipath_free();
+    lun=dictionary_new(0,"wwid");
+    if(lun==NULL)
+        return 0;
+    dir=sysroot_opendir(SYSBLOCK);
+    if(dir==NULL)
+        return 0;
+
+    /* pass 1, whole devices: multipath maps, kpartx maps and sd paths */
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(*de->d_name=='.')
+            continue;
+        if(sysfs_read(de->d_name,"dm/uuid",uuid,sizeof(uuid))>0)
+        {
+            if(!memcmp(uuid,"mpath-",6))
+            {
+                lun_add_dm(de->d_name,uuid+6,0);
+                lun_slaves(de->d_name,uuid+6);
+            }
+            else if(!memcmp(uuid,"part",4) && (cp=strstr(uuid,"-mpath-"))!=NULL)
+                lun_add_dm(de->d_name,cp+7,atoi(uuid+4));
+            continue;
+        }
+        if(sysfs_read(de->d_name,"device/wwid",uuid,sizeof(uuid))>0)
+        {
+            wwid_normalize(uuid,wwid,sizeof(wwid));
+            lun_add(de->d_name,1,wwid,0,0);
+        }
+    }
+
+    /* pass 2, partitions of the sd paths found above */
+    sysroot_rewinddir(dir);
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(*de->d_name=='.')
+            continue;
+        lun_partition(de->d_name);
+    }
+    sysroot_closedir(dir);
+    debug("%d devices grouped by wwid\n",lun->n-1);
+    return lun->n-1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief multipath_set   Store key=dev unless key already names a better
+ *                        path to the same LUN partition. Among equal
+ *                        ranks the lowest device name wins so the result
+ *                        does not depend on listing order.
+ */
+/*--------------------------------------------------------------------------*/
+int multipath_set(dictionary *d, const char *key, const char *dev)
+{
+    char  canon[UUID_STRLEN+1];
+    const char *idev;
+    char *old;
+    char *lold;
+    char *lnew;
+
+    if(uuid_canon(key,canon))
+        key=canon;                      /* 5FBD-7164 is stored 5fbd-7164 */
+
+    /* values are interned: the same device is the same pointer */
+    if(lun!=NULL && lun->n>1 && (old=dictionary_get(d,key,NULL))!=NULL
+       && (idev=intern(dev))!=NULL && old!=idev)
+    {
+        lold=dictionary_get(lun,old,NULL);
+        lnew=dictionary_get(lun,dev,NULL);
+        if(lold!=NULL && lnew!=NULL && !strcmp(lold+2,lnew+2))
+        {
+            if(*lold>*lnew || (*lold==*lnew && strcmp(old,dev)<0))
+            {
+                debug("%s: keeping %s over %s (%s)\n",key,old,dev,lold+2);
+                return 0;
+            }
+        }
+    }
+    return dictionary_set(d,key,dev);
+}
+
+/*-------------------------------------------------------------------------*/
+void multipath_free(void)
+{
+    if(lun!=NULL)
+        dictionary_del(&lun);
+}
@@ -0,0 +1,63 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    multipath.h
+   @author  Leslie Satenstein
+   @brief   Group block devices by LUN (WWID) so that a filesystem seen
+            through several SAN paths is stored once.
+
+   With four paths per LUN, /dev/disk/by-* and lsblk report the same
+   filesystem UUID on four sd devices plus the dm-multipath device.
+   dictionary_set() keeps whichever device it was given last, so the
+   annotation depended on listing order.
+
+   multipath_load() walks /sys/class/block once and records, for every
+   device name, the LUN it belongs to:
+       sd devices        /sys/class/block/sdX/device/wwid
+       multipath maps    /sys/class/block/dm-N/dm/uuid   "mpath-<wwid>"
+       kpartx partitions /sys/class/block/dm-N/dm/uuid   "partN-mpath-<wwid>"
+       slaves/           ties every sd path to its multipath map
+   multipath_set() is then used in place of dictionary_set() by the
+   discovery code. When the key is already present and the old and new
+   devices are paths to the same LUN partition, the multipath device wins
+   and the sd paths are not stored.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _MULTIPATH_H_
+#define _MULTIPATH_H_
+
+#include "dictionary.h"
+
+/**
+ * @brief multipath_load  Scan /sys/class/block and build the device to
+ *                        LUN table. Hosts without SAN storage end up
+ *                        with an empty table and multipath_set() behaves
+ *                        exactly like dictionary_set().
+ * @return                number of devices that belong to a LUN group
+ */
+int multipath_load(void);
+
+/**
+ * @brief multipath_set   dictionary_set() replacement for device values.
+ *                        If key already maps to another path of the same
+ *                        LUN partition, the preferred device (multipath
+ *                        over sd) is kept, independent of listing order.
+ *                        A key that is a UUID is stored in its canonical
+ *                        form (uuid.h).
+ * @param d               the dictionary
+ * @param key             UUID or LABEL key
+ * @param dev             device name as found under /dev (sdb7, dm-3)
+ * @return                0 if Ok, anything else as for dictionary_set()
+ */
+int multipath_set(dictionary *d, const char *key, const char *dev);
+
+/**
+ * @brief multipath_free  Release the device to LUN table.
+ */
+void multipath_free(void);
+
+#endif
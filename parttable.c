@@ -0,0 +1,498 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    parttable.c
+   @author  Leslie Satenstein
+   @brief   GPT and MBR partition table reader (see parttable.h)
+
+   On disk layout used here (all fields little endian)
+   MBR  LBA 0   440 disk id, 446 four 16 byte entries, 510 0x55AA
+   GPT  LBA 1   "EFI PART", 12 header size, 16 header crc32,
+                32 backup lba, 72 entries lba, 80 entry count,
+                84 entry size, 88 entry array crc32
+   GPT  entry   0 type guid, 16 unique guid, 32 first lba,
+                40 last lba, 56 name (36 UTF-16LE units)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "parttable.h"
+#include "sysroot.h"
+#include "multipath.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>           /* BLKSSZGET */
+
+#define GPT_LEADIN  34          /* MBR + header + 32 sectors of entries */
+#define GPT_MAXARRAY (1<<20)    /* refuse entry arrays larger than 1 MiB */
+#define PART_MAX    (GPT_MAXARRAY/128)  /* highest partno such an array gives */
+
+static uint32_t crctab[256];
+
+/*--------------------------------------------------------------------------*/
+static inline uint16_t le16(const unsigned char *p)
+{
+    return p[0] | p[1]<<8;
+}
+static inline uint32_t le32(const unsigned char *p)
+{
+    return p[0] | p[1]<<8 | p[2]<<16 | (uint32_t)p[3]<<24;
+}
+static inline uint64_t le64(const unsigned char *p)
+{
+    return le32(p) | (uint64_t)le32(p+4)<<32;
+}
+
+/*--------------------------------------------------------------------------*/
+/* IEEE 802.3 CRC32, as used by UEFI                                        */
+static uint32_t crc32(const unsigned char *p, size_t len)
+{
+    uint32_t crc=0xFFFFFFFF;
+    uint32_t c;
+    int i,k;
+
+    if(crctab[1]==0)
+    {
+        for(i=0;i<256;i++)
+        {
+            c=i;
+            for(k=0;k<8;k++)
+                c= (c&1) ? 0xEDB88320^(c>>1) : c>>1;
+            crctab[i]=c;
+        }
+    }
+    while(len--)
+        crc=crctab[(crc^*p++)&0xFF]^(crc>>8);
+    return crc^0xFFFFFFFF;
+}
+
+/*--------------------------------------------------------------------------*/
+/* GUIDs are stored mixed endian: the first three groups are little endian */
+static void guid_fmt(const unsigned char *g, char *out)
+{
+    sprintf(out,"%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+            le32(g),le16(g+4),le16(g+6),g[8],g[9],
+            g[10],g[11],g[12],g[13],g[14],g[15]);
+}
+
+/*--------------------------------------------------------------------------*/
+/* GPT names are UTF-16LE. Convert to UTF-8. The fstab side has its \040   */
+/* escapes decoded by fsspec_parse(), so the name is kept as is.           */
+static void name_fmt(const unsigned char *p, char *out, size_t size)
+{
+    size_t j=0;
+    unsigned c;
+    int i;
+
+    for(i=0;i<36;i++,p+=2)
+    {
+        c=le16(p);
+        if(c==0 || j+4>=size)
+            break;
+        if(c<0x80)
+            out[j++]=c;
+        else if(c<0x800)
+        {
+            out[j++]=0xC0|c>>6;
+            out[j++]=0x80|(c&0x3F);
+        }
+        else
+        {
+            out[j++]=0xE0|c>>12;
+            out[j++]=0x80|((c>>6)&0x3F);
+            out[j++]=0x80|(c&0x3F);
+        }
+    }
+    out[j]='\0';
+}
+
+/*--------------------------------------------------------------------------*/
+static int gpt_header_ok(unsigned char *h, unsigned sector)
+{
+    uint32_t hsize,crc;
+
+    if(memcmp(h,"EFI PART",8))
+        return 0;
+    hsize=le32(h+12);
+    if(hsize<92 || hsize>512 || hsize>sector)
+        return 0;
+    crc=le32(h+16);
+    memset(h+16,0,4);
+    if(crc32(h,hsize)!=crc)
+    {
+        debug("GPT header crc mismatch\n");
+        return 0;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/* Parse the entry array described by header h. lead holds the first       */
+/* GPT_LEADIN sectors; a second pread is issued only when the array lies   */
+/* outside of it.                                                          */
+static int gpt_entries(int fd, const unsigned char *h, unsigned sector,
+                       const unsigned char *lead, size_t leadlen,
+                       ptable_cb cb, void *arg)
+{
+    uint64_t lba=le64(h+72);
+    uint32_t count=le32(h+80);
+    uint32_t esize=le32(h+84);
+    size_t   len=(size_t)count*esize;
+    unsigned char *array;
+    unsigned char *e;
+    unsigned char *mem=NULL;
+    struct ptentry pe;
+    uint32_t i;
+    int n=0;
+    static const unsigned char zero[16];
+
+    if(esize<128 || len>GPT_MAXARRAY)
+        return -1;
+    /* lba comes from a header whose crc anyone can forge: no lba*sector */
+    /* before it is known not to wrap                                    */
+    if(lba<=leadlen/sector && len<=leadlen-lba*sector)
+        array=(unsigned char *)lead+lba*sector;
+    else
+    {
+        if(lba>(uint64_t)(INT64_MAX-GPT_MAXARRAY)/sector)
+            return -1;
+        mem=malloc(len);
+        if(mem==NULL)
+            return -2;
+        if(pread(fd,mem,len,(off_t)(lba*sector))!=(ssize_t)len)
+        {
+            free(mem);
+            return -2;
+        }
+        array=mem;
+    }
+    if(crc32(array,len)!=le32(h+88))
+    {
+        debug("GPT entry array crc mismatch\n");
+        free(mem);
+        return -1;
+    }
+    for(i=0,e=array;i<count;i++,e+=esize)
+    {
+        if(!memcmp(e,zero,16))          /* unused slot */
+            continue;
+        memset(&pe,0,sizeof(pe));
+        pe.partno=i+1;
+        pe.start=le64(e+32)*sector;
+        pe.size=(le64(e+40)-le64(e+32)+1)*sector;
+        guid_fmt(e,pe.type);
+        guid_fmt(e+16,pe.partuuid);
+        name_fmt(e+56,pe.partlabel,sizeof(pe.partlabel));
+        n++;
+        if(cb(&pe,arg))
+            break;
+    }
+    free(mem);
+    return n;
+}
+
+/*--------------------------------------------------------------------------*/
+/* MBR primary entries, then the EBR chain of an extended partition.       */
+/* Logical partitions are numbered from 5.                                 */
+static int mbr_entries(int fd, const unsigned char *mbr, unsigned sector,
+                       ptable_cb cb, void *arg)
+{
+    uint32_t diskid=le32(mbr+440);
+    uint64_t ext=0,ebr;
+    unsigned char buf[512];
+    const unsigned char *p;
+    struct ptentry pe;
+    int i,n=0,logical=5,guard;
+
+    /* a FAT or NTFS boot sector also ends in 0x55AA; its boot code does  */
+    /* not leave 0x00/0x80 in all four status bytes                       */
+    for(i=0;i<4;i++)
+        if(mbr[446+16*i]!=0x00 && mbr[446+16*i]!=0x80)
+            return -1;
+    for(i=0;i<4;i++)
+    {
+        p=mbr+446+16*i;
+        if(p[4]==0 || le32(p+12)==0)
+            continue;
+        if(p[4]==0x05 || p[4]==0x0F || p[4]==0x85)
+        {
+            ext=le32(p+8);
+            continue;
+        }
+        memset(&pe,0,sizeof(pe));
+        pe.partno=i+1;
+        pe.start=(uint64_t)le32(p+8)*sector;
+        pe.size=(uint64_t)le32(p+12)*sector;
+        sprintf(pe.partuuid,"%08x-%02x",diskid,pe.partno);
+        sprintf(pe.type,"0x%02x",p[4]);
+        n++;
+        if(cb(&pe,arg))
+            return n;
+    }
+    for(ebr=ext,guard=0; ext && guard<128; guard++)
+    {
+        if(pread(fd,buf,sizeof(buf),ebr*sector)!=sizeof(buf) || le16(buf+510)!=0xAA55)
+            break;
+        p=buf+446;
+        if(p[4]!=0 && le32(p+12)!=0)
+        {
+            memset(&pe,0,sizeof(pe));
+            pe.partno=logical++;
+            pe.start=(ebr+le32(p+8))*sector;
+            pe.size=(uint64_t)le32(p+12)*sector;
+            sprintf(pe.partuuid,"%08x-%02x",diskid,pe.partno);
+            sprintf(pe.type,"0x%02x",p[4]);
+            n++;
+            if(cb(&pe,arg))
+                break;
+        }
+        p+=16;                          /* link to the next EBR */
+        if(le32(p+8)==0)
+            break;
+        ebr=ext+le32(p+8);
+    }
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief parttable_read  Parse the MBR/GPT of an open disk or image
+ */
+/*--------------------------------------------------------------------------*/
+int parttable_read(int fd, unsigned sector, ptable_cb cb, void *arg)
+{
+    unsigned char *lead;
+    unsigned char hdr[4096];
+    unsigned char *h;
+    size_t  leadlen;
+    ssize_t got;
+    off_t   end;
+    int     n=-1;
+    int     gptdisk=0;
+    int     i;
+
+    if(sector==0)
+    {
+        if(ioctl(fd,BLKSSZGET,&i)==0 && i>=512 && i<=4096)
+            sector=i;
+    }
+    leadlen=GPT_LEADIN*(sector ? sector : 512);
+    lead=malloc(leadlen);
+    if(lead==NULL)
+        return -2;
+    got=pread(fd,lead,leadlen,0);
+    if(got<512)
+    {
+        free(lead);
+        return -2;
+    }
+    if(le16(lead+510)!=0xAA55)
+    {
+        free(lead);
+        return -1;
+    }
+    for(i=0;i<4;i++)
+        if(lead[446+16*i+4]==0xEE)
+            gptdisk=1;
+
+    if(gptdisk)
+    {
+        /* try the primary header at LBA 1 for each plausible sector size */
+        for(i=(sector ? sector : 512); i<=4096; i*=8)
+        {
+            if((size_t)got<(size_t)i+512)
+                break;
+            memcpy(hdr,lead+i,512);
+            if(gpt_header_ok(hdr,i))
+            {
+                sector=i;
+                n=gpt_entries(fd,hdr,sector,lead,got,cb,arg);
+                break;
+            }
+            if(sector)
+                break;
+        }
+        /* primary damaged: fall back to the backup header in the last LBA */
+        if(n<0)
+        {
+            if(sector==0)
+                sector=512;
+            end=lseek(fd,0,SEEK_END);
+            h=hdr;
+            if(end>0 && pread(fd,h,sector,end-sector)==(ssize_t)sector
+               && gpt_header_ok(h,sector))
+            {
+                debug("using backup GPT header\n");
+                n=gpt_entries(fd,h,sector,lead,0,cb,arg);
+            }
+        }
+    }
+    else
+        n=mbr_entries(fd,lead,sector ? sector : 512,cb,arg);
+    free(lead);
+    return n;
+}
+
+/*--------------------------------------------------------------------------*/
+/* partition number -> device name, for one disk                           */
+struct partmap
+{
+    char **name;                        /* name[partno], NULL if none */
+    int    count;
+};
+
+/* add the entries of /sys/block/<disk><sub> whose attr reads fmt, the     */
+/* first one met keeps a partno                                            */
+static void part_scan(const char *disk, const char *sub, const char *attr, const char *fmt,
+                      struct partmap *m)
+{
+    char path[PATH_MAX];
+    struct dirent *de;
+    sysdir *dir;
+    FILE *f;
+    void *p;
+    int   n,ok;
+
+    snprintf(path,sizeof(path),"/sys/block/%s%s",disk,sub);
+    dir=sysroot_opendir(path);
+    if(dir==NULL)
+        return;
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(*de->d_name=='.')
+            continue;
+        snprintf(path,sizeof(path),"/sys/block/%s%s/%s/%s",disk,sub,de->d_name,attr);
+        f=sysroot_fopen(path);
+        if(f==NULL)
+            continue;
+        ok= fscanf(f,fmt,&n)==1 && n>0 && n<=PART_MAX;
+        fclose(f);
+        if(!ok)
+            continue;
+        if(n>=m->count)
+        {
+            p=realloc(m->name,(n+1)*sizeof(char *));
+            if(p==NULL)
+                exit(-1);
+            m->name=p;
+            memset(m->name+m->count,0,(n+1-m->count)*sizeof(char *));
+            m->count=n+1;
+        }
+        if(m->name[n]==NULL && (m->name[n]=strdup(de->d_name))==NULL)
+            exit(-1);
+    }
+    sysroot_closedir(dir);
+}
+
+/* one pass over the partitions of disk, then over its kpartx holders     */
+static void part_map(const char *disk, struct partmap *m)
+{
+    m->name=NULL;
+    m->count=0;
+    /* sdb/sdb1/partition, nvme0n1/nvme0n1p3/partition */
+    part_scan(disk,"","partition","%d",m);
+    /* a multipath map has no partitions of its own: kpartx maps hold it, */
+    /* dm-5/dm/uuid "part1-mpath-<wwid>", ranked by multipath_load()      */
+    part_scan(disk,"/holders","dm/uuid","part%d-mpath-",m);
+}
+
+static void part_free(struct partmap *m)
+{
+    int i;
+
+    for(i=0;i<m->count;i++)
+        free(m->name[i]);
+    free(m->name);
+    m->name=NULL;
+    m->count=0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief parttable_devname  The device of partition partno of disk, as the
+ *                           kernel names it
+ */
+/*--------------------------------------------------------------------------*/
+int parttable_devname(const char *disk, int partno, char *out, size_t size)
+{
+    struct partmap m;
+    int found=-1;
+
+    part_map(disk,&m);
+    if(partno>0 && partno<m.count && m.name[partno]!=NULL)
+        found= snprintf(out,size,"%s",m.name[partno])<(int)size ? 0 : -1;
+    part_free(&m);
+    return found;
+}
+
+/*--------------------------------------------------------------------------*/
+struct fillarg
+{
+    dictionary    *d;
+    struct partmap map;                 /* of the disk being read */
+    int            keys;
+};
+
+static int fill_cb(const struct ptentry *pe, void *varg)
+{
+    struct fillarg *fa=varg;
+    const char *dev;
+    char key[sizeof(pe->partlabel)+16];
+
+    if(pe->partno<=0 || pe->partno>=fa->map.count || fa->map.name[pe->partno]==NULL)
+        return 0;                       /* no such partition device */
+    dev=fa->map.name[pe->partno];
+    sprintf(key,"PARTUUID=%s",pe->partuuid);
+    if(multipath_set(fa->d,key,dev)==0)
+        fa->keys++;
+    if(*pe->partlabel!='\0')
+    {
+        sprintf(key,"PARTLABEL=%s",pe->partlabel);
+        if(multipath_set(fa->d,key,dev)==0)
+            fa->keys++;
+    }
+    debug("%s partuuid=%s partlabel=%s\n",dev,pe->partuuid,pe->partlabel);
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief parttable_fill  PARTUUID= and PARTLABEL= keys for every disk
+ */
+/*--------------------------------------------------------------------------*/
+int parttable_fill(dictionary *d)
+{
+    sysdir *dir;
+    struct dirent *de;
+    struct fillarg fa;
+    char path[PATH_MAX];
+    int fd;
+
+    fa.d=d;
+    fa.keys=0;
+    dir=sysroot_opendir("/sys/block");
+    if(dir==NULL)
+        return 0;
+    while((de=sysroot_readdir(dir))!=NULL)
+    {
+        if(*de->d_name=='.')
+            continue;
+        snprintf(path,sizeof(path),"/dev/%s",de->d_name);
+        fd=sysroot_open(path,O_RDONLY|O_NONBLOCK);
+        if(fd<0)
+        {
+            debug("%s: %s\n",path,strerror(errno));
+            continue;
+        }
+        part_map(de->d_name,&fa.map);   /* once per disk, not per entry */
+        if(fa.map.count>0)
+            parttable_read(fd,0,fill_cb,&fa);
+        part_free(&fa.map);
+        close(fd);
+    }
+    sysroot_closedir(dir);
+    return fa.keys;
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    parttable.h
+   @author  Leslie Satenstein
+   @brief   GPT and MBR partition table reader.
+
+   PARTUUID= and PARTLABEL= fstab entries can not be resolved from
+   /dev/disk/by-uuid or /dev/disk/by-label, and udev may not be running.
+   This module reads the partition table of each whole disk directly:
+   the protective MBR, the GPT header and the GPT entry array are
+   obtained with a single pread() of the first 34 sectors in the common
+   layout. Header and entry array CRC32 values are verified; when the
+   primary GPT is damaged the backup at the end of the disk is used.
+
+   Dictionary keys are namespaced so they can not collide with a
+   filesystem LABEL:
+       PARTUUID=6d6e2c5f-0d1b-4a3e-9a0e-3f0f1e2d3c4b   GPT unique guid
+       PARTUUID=8e7f3a01-05                            MBR disk id - partno
+       PARTLABEL=EFI System                            GPT partition name
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _PARTTABLE_H_
+#define _PARTTABLE_H_
+
+#include "dictionary.h"
+
+/** One partition as found in the table. Offsets are in bytes. */
+struct ptentry
+{
+    int       partno;           /** 1.. as the kernel numbers them        */
+    uint64_t  start;            /** byte offset of the partition          */
+    uint64_t  size;             /** byte length of the partition          */
+    char      partuuid[40];     /** GPT guid or MBR "xxxxxxxx-NN"         */
+    char      partlabel[112];   /** GPT name, UTF-8. Empty for MBR        */
+    char      type[40];         /** GPT type guid or MBR type "0x83"      */
+};
+
+/** called once per partition by parttable_read(). Non zero stops the walk */
+typedef int (*ptable_cb)(const struct ptentry *pe, void *arg);
+
+/**
+ * @brief parttable_read  Parse the MBR/GPT found on an open disk or image
+ * @param fd              file descriptor open for reading
+ * @param sector          logical sector size, 0 to probe 512 then 4096
+ * @param cb              called for each partition found
+ * @param arg             passed through to cb
+ * @return                number of partitions, -1 if there is no valid
+ *                        partition table, -2 on read error
+ */
+int parttable_read(int fd, unsigned sector, ptable_cb cb, void *arg);
+
+/**
+ * @brief parttable_fill  Read the partition table of every whole disk
+ *                        in /sys/block and store PARTUUID= and PARTLABEL=
+ *                        keys with the partition device name as value.
+ * @param d               the dictionary
+ * @return                number of keys stored
+ */
+int parttable_fill(dictionary *d);
+
+/**
+ * @brief parttable_devname  Name of partition partno of disk, as the kernel
+ *                           lists it under /sys/block/<disk> (sda3,
+ *                           nvme0n1p3). For a multipath map it is the kpartx
+ *                           map holding it (dm-5), which multipath_load()
+ *                           ranks. Nothing is built from the disk name.
+ * @return                   0 if Ok, -1 if the disk has no such partition
+ */
+int parttable_devname(const char *disk, int partno, char *out, size_t size);
+
+#endif
@@ -0,0 +1,260 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    pathtrie.c
+   @author  Leslie Satenstein
+   @brief   Path prefix trie (see pathtrie.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "pathtrie.h"
+#include <limits.h>
+
+/*--------------------------------------------------------------------------*/
+static int node_new(pathtrie *t, const char *name, size_t len)
+{
+    void *p;
+
+    if(t->n==t->size)
+    {
+        t->size= t->size ? 2*t->size : 64;
+        p=realloc(t->node,t->size*sizeof(struct ptnode));
+        if(p==NULL)
+            return -1;
+        t->node=p;
+    }
+    t->node[t->n].name=strndup(name,len);
+    if(t->node[t->n].name==NULL)
+        return -1;
+    t->node[t->n].value=-1;
+    t->node[t->n].child=-1;
+    t->node[t->n].sibling=-1;
+    return t->n++;
+}
+
+/* path without leading, trailing and repeated slashes or "." components   */
+static int path_norm(const char *path, char *out, size_t size)
+{
+    size_t len,n=0;
+
+    for(;;)
+    {
+        while(*path=='/')
+            path++;
+        if(*path=='\0')
+            break;
+        len=strcspn(path,"/");
+        if(len!=1 || *path!='.')
+        {
+            if(n+len+2>size)
+                return -1;
+            if(n)
+                out[n++]='/';
+            memcpy(out+n,path,len);
+            n+=len;
+        }
+        path+=len;
+    }
+    out[n]='\0';
+    return 0;
+}
+
+/* length of the leading components name and p have in common, 0 if none  */
+static size_t common(const char *name, const char *p)
+{
+    size_t i,len=0;
+
+    for(i=0;;i++)
+    {
+        if((name[i]=='\0' || name[i]=='/') && (p[i]=='\0' || p[i]=='/'))
+        {
+            len=i;
+            if(name[i]=='\0' || p[i]=='\0')
+                break;
+        }
+        if(name[i]!=p[i])
+            break;
+    }
+    return len;
+}
+
+/* the child of node i sharing the first component of p, -1 if none       */
+static int child_find(const pathtrie *t, int i, const char *p, size_t *len)
+{
+    for(i=t->node[i].child; i>=0; i=t->node[i].sibling)
+    {
+        *len=common(t->node[i].name,p);
+        if(*len>0)
+            return i;
+    }
+    return -1;
+}
+
+/*-------------------------------------------------------------------------*/
+pathtrie *pathtrie_new(void)
+{
+    pathtrie *t;
+
+    t=calloc(1,sizeof(pathtrie));
+    if(t==NULL)
+        return NULL;
+    if(node_new(t,"",0)<0)
+        pathtrie_del(&t);
+    return t;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief pathtrie_add  Walk down, splitting a node where path leaves it
+ */
+/*--------------------------------------------------------------------------*/
+int pathtrie_add(pathtrie *t, const char *path, int value)
+{
+    char   buf[PATH_MAX];
+    char  *name;
+    const char *p=buf;
+    size_t len=0;
+    int i=0,j,k;
+
+    if(path_norm(path,buf,sizeof(buf))<0)
+        return -1;
+    while(*p!='\0')
+    {
+        j=child_find(t,i,p,&len);
+        if(j<0)                         /* the rest of path is one node */
+        {
+            j=node_new(t,p,strlen(p));
+            if(j<0)
+                return -1;
+            t->node[j].sibling=t->node[i].child;
+            t->node[i].child=j;
+            i=j;
+            break;
+        }
+        if(t->node[j].name[len]!='\0')  /* split srv/pg/data at srv */
+        {
+            k=node_new(t,t->node[j].name,len);
+            if(k<0)
+                return -1;
+            name=t->node[j].name;
+            memmove(name,name+len+1,strlen(name+len+1)+1);
+            t->node[k].child=j;
+            t->node[k].sibling=t->node[j].sibling;
+            t->node[j].sibling=-1;
+            if(t->node[i].child==j)
+                t->node[i].child=k;
+            else
+            {
+                for(i=t->node[i].child; t->node[i].sibling!=j; i=t->node[i].sibling)
+                    ;
+                t->node[i].sibling=k;
+            }
+            j=k;
+        }
+        i=j;
+        p+=len;
+        if(*p=='/')
+            p++;
+    }
+    t->node[i].value=value;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+int pathtrie_lpm(const pathtrie *t, const char *path, int proper)
+{
+    char   buf[PATH_MAX];
+    const char *p=buf;
+    size_t len=0;
+    int best;
+    int i=0;
+
+    if(path_norm(path,buf,sizeof(buf))<0)
+        return -1;
+    if(proper && *p=='\0')
+        return -1;                      /* / has no parent */
+    best=t->node[0].value;
+    while(*p!='\0')
+    {
+        i=child_find(t,i,p,&len);
+        if(i<0 || t->node[i].name[len]!='\0')
+            return best;
+        p+=len;
+        if(*p=='/')
+            p++;
+        if(proper && *p=='\0')
+            return best;
+        if(t->node[i].value>=0)
+            best=t->node[i].value;
+    }
+    return best;
+}
+
+/*--------------------------------------------------------------------------*/
+/* a value in the subtree of node i, -1 if none                            */
+static int subtree_value(const pathtrie *t, int i)
+{
+    int j,v;
+
+    if(t->node[i].value>=0)
+        return t->node[i].value;
+    for(j=t->node[i].child; j>=0; j=t->node[j].sibling)
+    {
+        v=subtree_value(t,j);
+        if(v>=0)
+            return v;
+    }
+    return -1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief pathtrie_under  Walk to path, then the first value below it.
+ *                        Nodes without a value have two children or
+ *                        more, so the first value is near.
+ */
+/*--------------------------------------------------------------------------*/
+int pathtrie_under(const pathtrie *t, const char *path)
+{
+    char   buf[PATH_MAX];
+    const char *p=buf;
+    size_t len=0;
+    int i=0,j,v;
+
+    if(path_norm(path,buf,sizeof(buf))<0)
+        return -1;
+    while(*p!='\0')
+    {
+        i=child_find(t,i,p,&len);
+        if(i<0)
+            return -1;
+        if(t->node[i].name[len]!='\0')  /* path ends inside this node */
+            return p[len]=='\0' ? subtree_value(t,i) : -1;
+        p+=len;
+        if(*p=='/')
+            p++;
+    }
+    for(j=t->node[i].child; j>=0; j=t->node[j].sibling)
+    {
+        v=subtree_value(t,j);
+        if(v>=0)
+            return v;
+    }
+    return -1;
+}
+
+/*-------------------------------------------------------------------------*/
+void pathtrie_del(pathtrie **t)
+{
+    int i;
+
+    if(t==NULL || *t==NULL)
+        return;
+    for(i=0;i<(*t)->n;i++)
+        free((*t)->node[i].name);
+    free((*t)->node);
+    free(*t);
+    *t=NULL;
+}
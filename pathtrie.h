@@ -0,0 +1,74 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    pathtrie.h
+   @author  Leslie Satenstein
+   @brief   Compressed path prefix trie.
+
+   Mountpoints are inserted with a value (the fstab entry number). A query
+   returns the value of the longest inserted path that is a prefix of the
+   query on component boundaries, so /home/alice finds /home but /homes
+   does not. A chain of components without a value of its own is one
+   node: with only /srv/pg/data inserted the root has the single child
+   "srv/pg/data", split at srv/ when /srv is added. A query costs one step
+   per component. Paths are compared after removing repeated slashes and
+   "." components. Nodes live in one array and refer to each other by
+   index.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _PATHTRIE_H_
+#define _PATHTRIE_H_
+
+#include "dictionary.h"
+
+struct ptnode
+{
+    char *name;                 /** components, "srv/pg", "" for the root */
+    int   value;                /** -1 if no path ends here               */
+    int   child;                /** first child, -1 if none               */
+    int   sibling;              /** next child of the same parent, or -1  */
+};
+
+typedef struct _pathtrie_
+{
+    struct ptnode *node;
+    int            n,size;
+} pathtrie;
+
+/**
+ * @brief pathtrie_new  An empty trie holding only "/"
+ */
+pathtrie *pathtrie_new(void);
+
+/**
+ * @brief pathtrie_add  Insert path with value, replacing an earlier value
+ * @return              0 if Ok, -1 if out of memory
+ */
+int pathtrie_add(pathtrie *t, const char *path, int value);
+
+/**
+ * @brief pathtrie_lpm  Longest prefix match
+ * @param t             the trie
+ * @param path          the query
+ * @param proper        1 to skip path itself, giving its parent mount
+ * @return              the value of the longest match, -1 if none
+ */
+int pathtrie_lpm(const pathtrie *t, const char *path, int proper);
+
+/**
+ * @brief pathtrie_under  A path inserted below path
+ * @return                the value of one path strictly below path, -1 if
+ *                        none
+ */
+int pathtrie_under(const pathtrie *t, const char *path);
+
+/**
+ * @brief pathtrie_del  Free the trie and set *t to NULL
+ */
+void pathtrie_del(pathtrie **t);
+
+#endif
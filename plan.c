@@ -0,0 +1,342 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    plan.c
+   @author  Leslie Satenstein
+   @brief   Mount plan waves (see plan.h)
+
+   -p, two steps. The earliest wave of each mount is 1 + the latest wave of
+   what it depends on, ignoring disks. The mounts are then placed in
+   order of that earliest wave, each one moved to a later wave while one
+   of its spindles is already busy in the wave it would take.
+
+   --fsck keeps the order of the pass numbers. Each pass is split into
+   rounds, a round takes every entry of the pass whose disks are not
+   already taken in that round, like fsck -A does for one disk.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "plan.h"
+#include "mounttab.h"
+#include "fsspec.h"
+#include <limits.h>
+
+struct mnt
+{
+    struct mountent *e;
+    int  parent;                        /* mount index, -1 if none */
+    int  bindsrc;                       /* mount holding a bind source */
+    int  minwave;
+    int  wave;                          /* -p wave, or --fsck step */
+    int  state;                         /* minwave(): 0 new, 1 busy, 2 done */
+};
+
+struct busy
+{
+    int  wave;
+    char disk[32];
+};
+
+static struct mnt *mnts;
+static int         nmnt;
+
+/*--------------------------------------------------------------------------*/
+static int minwave(int i)
+{
+    struct mnt *m=&mnts[i];
+    int w=0;
+
+    if(m->state==2)
+        return m->minwave;
+    if(m->state==1)                     /* a cycle, cut it */
+        return 0;
+    m->state=1;
+    if(m->parent>=0)
+        w=minwave(m->parent);
+    if(m->bindsrc>=0 && minwave(m->bindsrc)>w)
+        w=minwave(m->bindsrc);
+    m->minwave=w+1;
+    m->state=2;
+    return m->minwave;
+}
+
+/*--------------------------------------------------------------------------*/
+static int by_minwave(const void *a, const void *b)
+{
+    const struct mnt *x=&mnts[*(const int *)a];
+    const struct mnt *y=&mnts[*(const int *)b];
+
+    if(x->minwave!=y->minwave)
+        return x->minwave-y->minwave;
+    return x->e->line-y->e->line;
+}
+
+static int by_wave(const void *a, const void *b)
+{
+    const struct mnt *x=&mnts[*(const int *)a];
+    const struct mnt *y=&mnts[*(const int *)b];
+
+    if(x->wave!=y->wave)
+        return x->wave-y->wave;
+    return x->e->line-y->e->line;
+}
+
+static int by_pass(const void *a, const void *b)
+{
+    const struct mnt *x=&mnts[*(const int *)a];
+    const struct mnt *y=&mnts[*(const int *)b];
+
+    if(x->e->pass!=y->e->pass)
+        return x->e->pass-y->e->pass;
+    return x->e->line-y->e->line;
+}
+
+/*--------------------------------------------------------------------------*/
+/* a disk under both x and y                                               */
+static int disk_shared(const struct mnt *x, const struct mnt *y)
+{
+    int i,j;
+
+    for(i=0;i<x->e->ndisk;i++)
+        for(j=0;j<y->e->ndisk;j++)
+            if(!strcmp(x->e->disk[i],y->e->disk[j]))
+                return 1;
+    return 0;
+}
+
+/* the disks of m selected by mask, comma separated, and the end of line   */
+static void disks_write(FILE *f, const struct mnt *m, unsigned mask)
+{
+    int i,n=0;
+
+    for(i=0;i<m->e->ndisk;i++)
+        if(mask>>i&1)
+            fprintf(f,"%s%s",n++ ? "," : "",m->e->disk[i]);
+    fprintf(f,"%s\n",n ? "" : "-");
+}
+
+/*--------------------------------------------------------------------------*/
+/* the fstab, one struct mnt per entry                                     */
+static mounttab *plan_read(const dictionary *d, const char *fstab)
+{
+    mounttab *mt;
+    int i;
+
+    mt=mounttab_load(d,fstab,MT_DISKS);
+    if(mt==NULL)
+        return NULL;
+    nmnt=mt->n;
+    mnts=calloc(nmnt+1,sizeof(struct mnt));
+    if(mnts==NULL)
+        exit(-1);
+    for(i=0;i<nmnt;i++)
+    {
+        mnts[i].e=&mt->ent[i];
+        mnts[i].parent=mnts[i].bindsrc=-1;
+        if(mounttab_opt(mnts[i].e->opts,"bind") || mounttab_opt(mnts[i].e->opts,"rbind"))
+            mnts[i].bindsrc=-2;         /* resolved once the trie is built */
+    }
+    return mt;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief plan_write  Dependencies from the trie, then waves by spindle
+ */
+/*--------------------------------------------------------------------------*/
+int plan_write(FILE *f, const dictionary *d, const char *fstab)
+{
+    struct busy *busy;
+    struct mnt  *m;
+    mounttab *mt;
+    struct fsspec fs;
+    pathtrie *t;
+    int  *order;
+    int   nbusy=0;
+    int   waves=0;
+    int   i,j,k,w,clash;
+
+    mt=plan_read(d,fstab);
+    if(mt==NULL)
+        return -1;
+    t=pathtrie_new();
+    order=calloc(nmnt+1,sizeof(int));
+    busy=calloc(nmnt*DEVGRAPH_MAX+1,sizeof(struct busy));
+    if(t==NULL || order==NULL || busy==NULL)
+        exit(-1);
+
+    /* the trie, a repeated mountpoint waits for the mount it covers */
+    for(i=0;i<nmnt;i++)
+    {
+        m=&mnts[i];
+        if(*m->e->where=='\0')
+            continue;
+        j=pathtrie_lpm(t,m->e->where,0);
+        if(j>=0 && !strcmp(mnts[j].e->where,m->e->where))
+            m->parent=j;
+        pathtrie_add(t,m->e->where,i);
+    }
+    for(i=0;i<nmnt;i++)
+    {
+        m=&mnts[i];
+        if(*m->e->where!='\0' && m->parent<0)
+            m->parent=pathtrie_lpm(t,m->e->where,1);
+        if(m->bindsrc==-2)
+        {
+            m->bindsrc=-1;
+            if(fsspec_parse(m->e->spec,&fs)==SPEC_PATH)
+                m->bindsrc=pathtrie_lpm(t,fs.key,0);
+            if(m->bindsrc==i)
+                m->bindsrc=-1;
+        }
+    }
+    for(i=0;i<nmnt;i++)
+    {
+        minwave(i);
+        order[i]=i;
+    }
+
+    /* place in order of earliest wave, the dependencies are placed first */
+    qsort(order,nmnt,sizeof(int),by_minwave);
+    for(k=0;k<nmnt;k++)
+    {
+        m=&mnts[order[k]];
+        w=1;
+        if(m->parent>=0 && mnts[m->parent].wave>=w)
+            w=mnts[m->parent].wave+1;
+        if(m->bindsrc>=0 && mnts[m->bindsrc].wave>=w)
+            w=mnts[m->bindsrc].wave+1;
+        do
+        {
+            clash=0;
+            for(i=0;i<m->e->ndisk && !clash;i++)
+                for(j=0;j<nbusy && !clash;j++)
+                    clash= (m->e->spin>>i&1) && busy[j].wave==w && !strcmp(busy[j].disk,m->e->disk[i]);
+            if(clash)
+                w++;
+        } while(clash);
+        m->wave=w;
+        for(i=0;i<m->e->ndisk;i++)
+        {
+            if(!(m->e->spin>>i&1))
+                continue;
+            busy[nbusy].wave=w;
+            strcpy(busy[nbusy++].disk,m->e->disk[i]);
+        }
+        if(w>waves)
+            waves=w;
+    }
+
+    qsort(order,nmnt,sizeof(int),by_wave);
+    fprintf(f,"#wave\tmount\tspec\tdevice\tspindles\n");
+    for(k=0;k<nmnt;k++)
+    {
+        m=&mnts[order[k]];
+        fprintf(f,"%d\t%s\t%s\t%s\t",m->wave,*m->e->where ? m->e->where : "swap",m->e->spec,
+                *m->e->dev ? m->e->dev : "-");
+        disks_write(f,m,m->e->spin);
+    }
+    fprintf(stderr,"%d mounts in %d waves\n",nmnt,waves);
+    pathtrie_del(&t);
+    free(order);
+    free(busy);
+    free(mnts);
+    mnts=NULL;
+    nmnt=0;
+    mounttab_del(&mt);
+    return waves;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief fsck_write  Rounds per pass, one filesystem per disk per round
+ */
+/*--------------------------------------------------------------------------*/
+int fsck_write(FILE *f, const dictionary *d, const char *fstab)
+{
+    struct mnt *m,*o;
+    mounttab *mt;
+    int  *order;
+    int   n=0;
+    int   steps=0;
+    int   first,last,left;
+    int   i,j,k;
+
+    mt=plan_read(d,fstab);
+    if(mt==NULL)
+        return -1;
+    order=calloc(nmnt+1,sizeof(int));
+    if(order==NULL)
+        exit(-1);
+    for(i=0;i<nmnt;i++)
+        if(mnts[i].e->pass>0)
+            order[n++]=i;
+    qsort(order,n,sizeof(int),by_pass);
+
+    for(first=0;first<n;first=last)
+    {
+        for(last=first;last<n && mnts[order[last]].e->pass==mnts[order[first]].e->pass;last++)
+            mnts[order[last]].wave=0;
+        /* a round takes, in fstab order, each entry whose disks are free */
+        for(left=last-first;left>0;)
+        {
+            steps++;
+            for(k=first;k<last;k++)
+            {
+                m=&mnts[order[k]];
+                if(m->wave)
+                    continue;
+                for(j=first;j<last;j++)
+                {
+                    o=&mnts[order[j]];
+                    if(o->wave==steps && disk_shared(m,o))
+                        break;
+                }
+                if(j<last)
+                    continue;
+                m->wave=steps;
+                left--;
+            }
+        }
+    }
+
+    /* pass numbers that only order entries which share no disk */
+    for(k=0;k<n;k++)
+    {
+        m=&mnts[order[k]];
+        if(m->e->pass==1 && strcmp(m->e->where,"/"))
+            fprintf(stderr,"fsck: %s has pass 1, everything in pass 2 and later waits for it\n",
+                    *m->e->where ? m->e->where : m->e->spec);
+        if(m->e->pass<=2 || m->e->ndisk==0)
+            continue;
+        for(j=0;j<k;j++)
+        {
+            o=&mnts[order[j]];
+            if(o->e->pass>=2 && o->e->pass<m->e->pass && disk_shared(m,o))
+                break;
+        }
+        if(j==k)
+            fprintf(stderr,"fsck: %s has pass %d but shares no disk with an earlier pass,"
+                    " with pass 2 it would be checked in parallel\n",
+                    *m->e->where ? m->e->where : m->e->spec,m->e->pass);
+    }
+
+    qsort(order,n,sizeof(int),by_wave);
+    fprintf(f,"#step\tpass\tmount\tspec\tdevice\tdisks\n");
+    for(k=0;k<n;k++)
+    {
+        m=&mnts[order[k]];
+        fprintf(f,"%d\t%d\t%s\t%s\t%s\t",m->wave,m->e->pass,*m->e->where ? m->e->where : "swap",
+                m->e->spec,*m->e->dev ? m->e->dev : "-");
+        disks_write(f,m,~0u);
+    }
+    fprintf(stderr,"%d filesystems in %d fsck steps\n",n,steps);
+    free(order);
+    free(mnts);
+    mnts=NULL;
+    nmnt=0;
+    mounttab_del(&mt);
+    return steps;
+}
@@ -0,0 +1,54 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    plan.h
+   @author  Leslie Satenstein
+   @brief   Mount plan (-p): the fstab as waves of mounts that can be
+            issued at the same time.
+
+   A mount waits for
+       the mount of its parent directory      /home before /home/alice
+       the mount holding a bind source        /data before /srv (bind)
+       an earlier mount in the same wave on the same spinning disk
+   Parents come from a prefix trie of the mountpoints (pathtrie.h), disks
+   from the device stacking (devgraph.h). Solid state disks do not
+   serialize. Swap entries have no parent. noauto entries are left out.
+   The plan is written tab separated, in wave order:
+       #wave  mount  spec  device  spindles
+
+   The fsck plan (--fsck) uses the sixth fstab field. Pass 1 is checked
+   first, then pass 2 and so on, pass 0 is not checked. Entries of one
+   pass are checked in parallel except when they share a disk, those go
+   into successive steps. A pass number that serializes entries on
+   different disks is reported on stderr.
+       #step  pass  mount  spec  device  disks
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _PLAN_H_
+#define _PLAN_H_
+
+#include "dictionary.h"
+
+/**
+ * @brief plan_write  Compute and write the mount waves of fstab
+ * @param f           output stream
+ * @param d           the dictionary, spec to device name
+ * @param fstab       the fstab, read under --root
+ * @return            number of waves, -1 if fstab can not be read
+ */
+int plan_write(FILE *f, const dictionary *d, const char *fstab);
+
+/**
+ * @brief fsck_write  Compute and write the fsck steps of fstab
+ * @param f           output stream
+ * @param d           the dictionary, spec to device name
+ * @param fstab       the fstab, read under --root
+ * @return            number of steps, -1 if fstab can not be read
+ */
+int fsck_write(FILE *f, const dictionary *d, const char *fstab);
+
+#endif
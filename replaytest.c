@@ -0,0 +1,287 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    replaytest.c
+   @author  Leslie Satenstein
+   @brief   replay_open() on hostile archives, and a live discovery of this
+            host against its replay.
+
+   replaytest [runs]
+
+   Writes capture files by hand, in the layout of capture.c, with paths
+   holding . or .. components or a NUL byte, entries out of order and
+   offsets past the end of the file; replay_open() must refuse each one.
+   A link to an outside directory is accepted, but reading a file below
+   it must not reach the real file there.
+
+   Then captures this host with capture_write(), runs the discovery of
+   create_dictionary() (fstabxref.c) live and replayed, runs times each
+   (default 20), and prints the time of both. The two dictionaries must
+   hold the same keys and values. Exits 1 and says which case failed
+   otherwise.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "capture.h"
+#include "sysroot.h"
+#include "fsspec.h"
+#include "multipath.h"
+#include "parttable.h"
+#include "loopdev.h"
+#include "devtable.h"
+#include <limits.h>
+#include <time.h>
+
+/* as in capture.c */
+struct caphead
+{
+    char     magic[8];
+    uint32_t count;
+    uint32_t pad;
+};
+
+struct capidx
+{
+    uint64_t path;
+    uint64_t data;
+    uint64_t len;
+    uint64_t size;
+    uint64_t dev;
+    uint64_t rdev;
+    uint32_t pathlen;
+    uint32_t type;
+    uint32_t mode;
+    uint32_t pad;
+};
+
+struct ent
+{
+    const char *path;
+    size_t      pathlen;                /* 0 for strlen(path) */
+    int         type;
+    const char *data;
+};
+
+static char outside[PATH_MAX];          /* holds secret, never read */
+
+/*--------------------------------------------------------------------------*/
+static void write_archive(const char *file, const struct ent *e, int n, uint64_t skew)
+{
+    struct caphead head;
+    struct capidx  idx;
+    uint64_t off;
+    FILE *f;
+    int i;
+
+    f=fopen(file,"wb");
+    if(f==NULL)
+        exit(2);
+    memset(&head,0,sizeof(head));
+    memcpy(head.magic,"FSXCAP2\n",8);
+    head.count=n;
+    fwrite(&head,sizeof(head),1,f);
+    off=sizeof(head)+(uint64_t)n*sizeof(idx);
+    for(i=0;i<n;i++)
+    {
+        memset(&idx,0,sizeof(idx));
+        idx.pathlen= e[i].pathlen ? e[i].pathlen : strlen(e[i].path);
+        idx.path=off;
+        idx.data=off+idx.pathlen;
+        idx.len= e[i].data ? strlen(e[i].data) : 0;
+        idx.size=idx.len;
+        idx.type=e[i].type;
+        off=idx.data+idx.len;
+        idx.data+=skew;
+        fwrite(&idx,sizeof(idx),1,f);
+    }
+    for(i=0;i<n;i++)
+    {
+        fwrite(e[i].path,1,e[i].pathlen ? e[i].pathlen : strlen(e[i].path),f);
+        if(e[i].data)
+            fputs(e[i].data,f);
+    }
+    fclose(f);
+}
+
+/*--------------------------------------------------------------------------*/
+static int refused(const char *name, const char *file, const struct ent *e, int n,
+                   uint64_t skew)
+{
+    int ok;
+
+    write_archive(file,e,n,skew);
+    ok= replay_open(file)!=0;
+    replay_close();
+    printf("%-28s %s\n",name,ok ? "ok" : "ACCEPTED");
+    return ok;
+}
+
+static int contained(const char *name, const char *file, const struct ent *e, int n)
+{
+    char  buf[64]="";
+    FILE *f;
+    int   ok;
+
+    write_archive(file,e,n,0);
+    ok= replay_open(file)==0;
+    if(ok && (f=sysroot_fopen("/a/secret"))!=NULL)
+    {
+        ok= fgets(buf,sizeof(buf),f)==NULL || strcmp(buf,"outside")!=0;
+        fclose(f);
+    }
+    replay_close();
+    printf("%-28s %s\n",name,ok ? "ok" : "ESCAPED");
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/* the discovery of create_dictionary(), dumped to a string                 */
+static char *discover(const char *fstab, size_t *len)
+{
+    dictionary *d;
+    devtable *t;
+    char *dump;
+    FILE *f;
+
+    d=dictionary_new(32,"uuid");
+    if(d==NULL)
+        exit(2);
+    multipath_load();
+    fsspec_links(d,"/dev/disk/by-uuid","");
+    fsspec_links(d,"/dev/disk/by-label","");
+    fsspec_links(d,"/dev/disk/by-id","ID=");
+    parttable_fill(d);
+    loopdev_fill(d);
+    t=devtable_new();
+    devtable_load(t);
+    filedev_fill(d,t,fstab);
+    multipath_free();
+    f=open_memstream(&dump,len);
+    if(f==NULL)
+        exit(2);
+    dictionary_dump(d,f);
+    fclose(f);
+    devtable_del(&t);
+    dictionary_del(&d);
+    return dump;
+}
+
+static double elapsed(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    return (t1.tv_sec-t0->tv_sec)*1e3+(t1.tv_nsec-t0->tv_nsec)/1e6;
+}
+
+static int live_replay(const char *file, int runs)
+{
+    const char *fstab="/etc/fstab";
+    struct timespec t0;
+    char  *live,*replay;
+    size_t nlive,nreplay;
+    double tlive,treplay;
+    int    i,ok;
+
+    if(capture_write(file,fstab)<0)
+    {
+        printf("%-28s %s\n","capture of this host","FAILED");
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for(i=0;i<runs;i++)
+        free(discover(fstab,&nlive));
+    tlive=elapsed(&t0);
+    live=discover(fstab,&nlive);
+
+    if(replay_open(file))
+    {
+        free(live);
+        printf("%-28s %s\n","replay of this host","FAILED");
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for(i=0;i<runs;i++)
+        free(discover(fstab,&nreplay));
+    treplay=elapsed(&t0);
+    replay=discover(fstab,&nreplay);
+    replay_close();
+
+    ok= nlive==nreplay && memcmp(live,replay,nlive)==0;
+    printf("%-28s %s\n","live and replay agree",ok ? "ok" : "DIFFER");
+    printf("%d discoveries: live %.1f ms, replay %.1f ms\n",runs,tlive,treplay);
+    free(live);
+    free(replay);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    char  file[PATH_MAX+8];
+    char  secret[PATH_MAX+8];
+    FILE *f;
+    int   runs= argc>1 ? atoi(argv[1]) : 20;
+    int   ok=1;
+
+    snprintf(outside,sizeof(outside),"/tmp/replaytest.XXXXXX");
+    if(mkdtemp(outside)==NULL)
+        exit(2);
+    snprintf(file,sizeof(file),"%s.cap",outside);
+    snprintf(secret,sizeof(secret),"%s/secret",outside);
+    f=fopen(secret,"w");
+    if(f==NULL)
+        exit(2);
+    fputs("outside",f);
+    fclose(f);
+
+    {
+        struct ent e[]={ { "/a", 0, CAP_LINK, outside } };
+        ok&=contained("link to an outside dir",file,e,1);
+    }
+    {
+        struct ent e[]={ { "/a", 0, CAP_LINK, "../../../.." } };
+        ok&=contained("link of ..",file,e,1);
+    }
+    {
+        struct ent e[]={ { "/../x", 0, CAP_FILE, "x" } };
+        ok&=refused("leading ..",file,e,1,0);
+    }
+    {
+        struct ent e[]={ { "/x/../../y", 0, CAP_FILE, "x" } };
+        ok&=refused("inner ..",file,e,1,0);
+    }
+    {
+        struct ent e[]={ { "/x/.", 0, CAP_LINK, "/" } };
+        ok&=refused("trailing .",file,e,1,0);
+    }
+    {
+        struct ent e[]={ { "/x//y", 0, CAP_FILE, "x" } };
+        ok&=refused("empty component",file,e,1,0);
+    }
+    {
+        struct ent e[]={ { "/x\0y", 4, CAP_FILE, "x" } };
+        ok&=refused("NUL in a path",file,e,1,0);
+    }
+    {
+        struct ent e[]={ { "/b", 0, CAP_FILE, "x" }, { "/a", 0, CAP_FILE, "x" } };
+        ok&=refused("out of order",file,e,2,0);
+    }
+    {
+        struct ent e[]={ { "/a", 0, CAP_FILE, "x" }, { "/a", 0, CAP_FILE, "x" } };
+        ok&=refused("twice the same path",file,e,2,0);
+    }
+    {
+        struct ent e[]={ { "/a", 0, CAP_FILE, "x" } };
+        ok&=refused("data past the end",file,e,1,1);
+    }
+
+    ok&=live_replay(file,runs);
+
+    unlink(file);
+    unlink(secret);
+    rmdir(outside);
+    return ok ? 0 : 1;
+}
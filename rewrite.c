@@ -0,0 +1,167 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    rewrite.c
+   @author  Leslie Satenstein
+   @brief   Namespace rewriting of fstab specs (see rewrite.h)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "rewrite.h"
+#include "fsspec.h"
+#include "mounttab.h"
+#include "sysroot.h"
+#include <strings.h>
+
+static const char *tags[SPEC_KINDS]=
+{
+    [SPEC_UUID]="UUID=",
+    [SPEC_LABEL]="LABEL=",
+    [SPEC_PARTUUID]="PARTUUID=",
+    [SPEC_PARTLABEL]="PARTLABEL=",
+};
+
+/*--------------------------------------------------------------------------*/
+int rewrite_target(const char *ns)
+{
+    int i;
+
+    for(i=0;i<SPEC_KINDS;i++)
+        if(tags[i]!=NULL && !strncasecmp(ns,tags[i],strlen(tags[i])-1)
+           && (ns[strlen(tags[i])-1]=='\0' || ns[strlen(tags[i])-1]=='='))
+            return i;
+    return -1;
+}
+
+/*--------------------------------------------------------------------------*/
+struct revarg
+{
+    dictionary *rev;
+    const char *tag;
+};
+
+static int reverse_cb(const char *name, const char *target, void *varg)
+{
+    struct revarg *ra=varg;
+    char key[PATH_MAX+16];
+    char val[PATH_MAX];
+    const char *dev;
+
+    dev=strrchr(target,'/');
+    dev= dev ? dev+1 : target;
+    snprintf(key,sizeof(key),"%s%s",ra->tag,dev);
+    snprintf(val,sizeof(val),"%s",name);
+    dictionary_set(ra->rev,key,fsspec_decode(val));
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief rewrite_reverse  The links for UUID and LABEL, which share the
+ *                         untagged keys of the dictionary, the tagged
+ *                         keys turned around
+ */
+/*--------------------------------------------------------------------------*/
+dictionary *rewrite_reverse(const dictionary *d)
+{
+    dictionary *rev;
+    struct revarg ra;
+    char  key[PATH_MAX+16];
+    const char *eq;
+    int   i;
+
+    rev=dictionary_new(32,"reverse");
+    if(rev==NULL)
+        exit(32);
+    ra.rev=rev;
+    ra.tag="UUID=";
+    sysroot_links("/dev/disk/by-uuid",reverse_cb,&ra);
+    ra.tag="LABEL=";
+    sysroot_links("/dev/disk/by-label",reverse_cb,&ra);
+    for(i=0;i<d->size;i++)
+    {
+        if(d->key[i]==NULL || d->val[i]==NULL
+           || (strncmp(d->key[i],"PARTUUID=",9) && strncmp(d->key[i],"PARTLABEL=",10)))
+            continue;
+        eq=strchr(d->key[i],'=');
+        snprintf(key,sizeof(key),"%.*s%s",(int)(eq-d->key[i]+1),d->key[i],d->val[i]);
+        dictionary_set(rev,key,eq+1);
+    }
+    return rev;
+}
+
+/*--------------------------------------------------------------------------*/
+/* val with the fstab escapes for blank, tab, newline and backslash        */
+static void spec_encode(FILE *out, const char *val)
+{
+    for(;*val;val++)
+        if(*val==' ' || *val=='\t' || *val=='\n' || *val=='\\')
+            fprintf(out,"\\%03o",(unsigned char)*val);
+        else
+            fputc(*val,out);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief rewrite_stream  Line by line, only the span of the first field
+ *                        is replaced
+ */
+/*--------------------------------------------------------------------------*/
+int rewrite_stream(FILE *out, FILE *in, const char *name, const dictionary *d,
+                   const dictionary *rev, int target)
+{
+    struct fsspec fs;
+    char   spec[PATH_MAX];
+    char   key[64];
+    char   dev[32];
+    char  *line=NULL;
+    char  *val;
+    size_t cap=0;
+    size_t lead,len;
+    long   lineno=0;
+    int    failed=0;
+    int    kind;
+
+    while(getline(&line,&cap,in)!=-1)
+    {
+        lineno++;
+        lead=strspn(line," \t");
+        len=strcspn(line+lead," \t\r\n");
+        if(len==0 || line[lead]=='#' || len>=sizeof(spec))
+        {
+            fputs(line,out);
+            continue;
+        }
+        memcpy(spec,line+lead,len);
+        spec[len]='\0';
+        kind=fsspec_parse(spec,&fs);
+        if(!strncmp(spec,tags[target],strlen(tags[target])))
+            kind=SPEC_OTHER;            /* already there */
+        if(kind==SPEC_PATH && strncmp(fs.key,"/dev/",5))
+            kind=SPEC_OTHER;            /* a file or a bind source */
+        if(kind==SPEC_OTHER)
+        {
+            fputs(line,out);
+            continue;
+        }
+        mounttab_dev(d,spec,dev,sizeof(dev));
+        snprintf(key,sizeof(key),"%s%s",tags[target],dev);
+        val= *dev ? dictionary_get(rev,key,NULL) : NULL;
+        if(val==NULL)
+        {
+            fprintf(stderr,"%s:%ld: %s: %s\n",name,lineno,spec,
+                    *dev ? "no identifier in the target namespace" : "device not found");
+            failed++;
+            fputs(line,out);
+            continue;
+        }
+        fwrite(line,1,lead,out);
+        fputs(tags[target],out);
+        spec_encode(out,val);
+        fputs(line+lead+len,out);
+    }
+    free(line);
+    return failed;
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    rewrite.h
+   @author  Leslie Satenstein
+   @brief   Rewrite the first fstab field into one namespace (-w).
+
+   Discovery maps identifiers to devices. The reverse map, device to
+   identifier, is built from the same sources: the by-uuid and by-label
+   links, and the PARTUUID=, PARTLABEL= and ID= keys of the dictionary.
+   A spec is resolved forward to its device, then back into the target:
+       /dev/sdb2             ->  UUID=3f0e...
+       LABEL=data            ->  UUID=3f0e...
+       UUID=3f0e...          ->  PARTUUID=8c1d...-02
+   Only the first field changes, every other byte of the input, comments,
+   spacing and tabs included, is copied as is. Specs that are no block
+   device (tmpfs, nfs, bind sources) are left alone without a word; a
+   block device spec that can not be converted is left as it was and
+   reported on stderr with its line number.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _REWRITE_H_
+#define _REWRITE_H_
+
+#include "dictionary.h"
+
+/**
+ * @brief rewrite_target  The namespace named by ns
+ * @param ns              UUID, LABEL, PARTUUID or PARTLABEL
+ * @return                SPEC_UUID ... (fsspec.h), -1 if unknown
+ */
+int rewrite_target(const char *ns);
+
+/**
+ * @brief rewrite_reverse  Device to identifier map, keys "UUID=sdb2"
+ * @param d                the dictionary of discovery
+ * @return                 the reverse dictionary
+ */
+dictionary *rewrite_reverse(const dictionary *d);
+
+/**
+ * @brief rewrite_stream  Copy in to out, rewriting the specs
+ * @param out             output stream
+ * @param in              fstab stream
+ * @param name            name of in, for the reports
+ * @param d               the dictionary, spec to device
+ * @param rev             from rewrite_reverse()
+ * @param target          from rewrite_target()
+ * @return                number of specs that could not be converted
+ */
+int rewrite_stream(FILE *out, FILE *in, const char *name, const dictionary *d,
+                   const dictionary *rev, int target);
+
+#endif
@@ -0,0 +1,229 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    sysattr.c
+   @author  Leslie Satenstein
+   @brief   Batched sysfs attribute enrichment (see sysattr.h)
+
+   Attribute files, relative to /sys/class/block/<dev>. For a partition
+   the directory is a child of its disk's, so "../" reaches the disk.
+       size         size                       (512 byte sectors)
+       rotational   queue/rotational           ../queue/rotational
+       model        device/model               ../device/model
+       serial       device/serial, serial      (nvme, virtio)
+                    device/vpd_pg80            (SCSI, binary page 0x80)
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "sysattr.h"
+#include "sysroot.h"
+#include <limits.h>
+
+struct sysattr
+{
+    char     name[32];
+    uint64_t sectors;
+    int      rotational;        /* -1 unknown */
+    char     model[48];
+    char     serial[64];
+};
+
+static struct sysattr *attrs;
+static int             nattr;
+
+/*-------------------------------------------------------------------------*/
+unsigned sysattr_need(const char *tmpl)
+{
+    unsigned mask=0;
+    const char *cp;
+
+    for(cp=tmpl; cp!=NULL && (cp=strchr(cp,'%'))!=NULL; cp+=2)
+    {
+        switch(cp[1])
+        {
+        case 's': mask|=SA_SIZE;   break;
+        case 'r': mask|=SA_ROTA;   break;
+        case 'm': mask|=SA_MODEL;  break;
+        case 'S': mask|=SA_SERIAL; break;
+        case '\0': return mask;
+        default:  break;
+        }
+    }
+    return mask;
+}
+
+/*--------------------------------------------------------------------------*/
+/* read the first of the relative paths that exists, blanks trimmed.       */
+/* Returns the length, or -1                                               */
+static int attr_read(sysdir *dir, const char * const *paths, char *buf, size_t size)
+{
+    int len;
+
+    for( ; *paths!=NULL; paths++)
+    {
+        len=sysroot_readat(dir,*paths,buf,size-1);
+        if(len<=0)
+            continue;
+        buf[len]='\0';
+        if(strstr(*paths,"vpd_pg80"))   /* 4 byte page header, then ascii */
+        {
+            if(len<=4)
+                continue;
+            memmove(buf,buf+4,len-3);
+            len-=4;
+        }
+        while(len>0 && (unsigned char)buf[len-1]<=' ')
+            buf[--len]='\0';
+        while(*buf==' ')
+            memmove(buf,buf+1,len--);
+        return len;
+    }
+    return -1;
+}
+
+static const char * const p_size[]  ={ "size", NULL };
+static const char * const p_rota[]  ={ "queue/rotational", "../queue/rotational", NULL };
+static const char * const p_model[] ={ "device/model", "../device/model", NULL };
+static const char * const p_serial[]={ "device/serial", "serial", "device/vpd_pg80",
+                                       "../device/serial", "../serial", "../device/vpd_pg80", NULL };
+
+/*--------------------------------------------------------------------------*/
+static int attr_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct sysattr *)a)->name,((const struct sysattr *)b)->name);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief sysattr_fetch  One pass over the devices of the dictionary
+ */
+/*--------------------------------------------------------------------------*/
+int sysattr_fetch(const dictionary *d, unsigned mask)
+{
+    struct sysattr *a;
+    char buf[256];
+    char path[PATH_MAX];
+    sysdir *dir;
+    int  i,j;
+
+    sysattr_free();
+    if(mask==0 || d==NULL)
+        return 0;
+    attrs=calloc(d->size,sizeof(struct sysattr));
+    if(attrs==NULL)
+        return 0;
+
+    /* the device names: values that are a bare name, deduplicated */
+    for(i=d->lower+1;i<d->size;i++)
+    {
+        if(d->key[i]==NULL || d->val[i]==NULL || *d->val[i]=='\0'
+           || strpbrk(d->val[i],"/ @")!=NULL || strlen(d->val[i])>=sizeof(attrs->name))
+            continue;
+        strcpy(attrs[nattr++].name,d->val[i]);
+    }
+    qsort(attrs,nattr,sizeof(struct sysattr),attr_cmp);
+    for(i=j=0;i<nattr;i++)
+        if(j==0 || strcmp(attrs[j-1].name,attrs[i].name))
+            attrs[j++]=attrs[i];
+    nattr=j;
+
+    for(i=0,a=attrs;i<nattr;i++,a++)
+    {
+        a->rotational=-1;
+        snprintf(path,sizeof(path),"/sys/class/block/%s",a->name);
+        dir=sysroot_opendir(path);      /* the attributes are read relative to it */
+        if(dir==NULL)
+            continue;
+        if((mask&SA_SIZE) && attr_read(dir,p_size,buf,sizeof(buf))>0)
+            a->sectors=strtoull(buf,NULL,10);
+        if((mask&SA_ROTA) && attr_read(dir,p_rota,buf,sizeof(buf))>0)
+            a->rotational=atoi(buf);
+        if(mask&SA_MODEL)
+            attr_read(dir,p_model,a->model,sizeof(a->model));
+        if(mask&SA_SERIAL)
+            attr_read(dir,p_serial,a->serial,sizeof(a->serial));
+        sysroot_closedir(dir);
+    }
+    debug("%d devices enriched, mask %x\n",nattr,mask);
+    return nattr;
+}
+
+/*--------------------------------------------------------------------------*/
+/* 1024 based size the way lsblk shows it: 3.6T, 500G                      */
+static void size_fmt(uint64_t bytes, char *out, size_t size)
+{
+    static const char units[]="BKMGTPE";
+    double v=bytes;
+    int u=0;
+
+    while(v>=1024 && units[u+1]!='\0')
+    {
+        v/=1024;
+        u++;
+    }
+    if(v<10 && u>0)
+        snprintf(out,size,"%.1f%c",v,units[u]);
+    else
+        snprintf(out,size,"%.0f%c",v,units[u]);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief sysattr_format Expand the template for one device
+ */
+/*--------------------------------------------------------------------------*/
+char *sysattr_format(const char *tmpl, const char *prefix, const char *dev, char *out, size_t size)
+{
+    struct sysattr key;
+    struct sysattr *a=NULL;
+    const char *cp;
+    char  num[32];
+    size_t j=0;
+
+    snprintf(key.name,sizeof(key.name),"%s",dev);
+    if(nattr)
+        a=bsearch(&key,attrs,nattr,sizeof(struct sysattr),attr_cmp);
+    *out='\0';
+    for(cp=tmpl; *cp!='\0' && j<size-1; cp++)
+    {
+        if(*cp!='%' || cp[1]=='\0')
+        {
+            out[j++]=*cp;
+            continue;
+        }
+        switch(*++cp)
+        {
+        case 'd': j+=snprintf(out+j,size-j,"%s%s",prefix,dev); break;
+        case 'n': j+=snprintf(out+j,size-j,"%s",dev); break;
+        case 's':
+            if(a && a->sectors)
+            {
+                size_fmt(a->sectors*512,num,sizeof(num));
+                j+=snprintf(out+j,size-j,"%s",num);
+            }
+            else
+                j+=snprintf(out+j,size-j,"-");
+            break;
+        case 'r':
+            j+=snprintf(out+j,size-j,"%s",(a==NULL || a->rotational<0) ? "-" : a->rotational ? "HDD" : "SSD");
+            break;
+        case 'm': j+=snprintf(out+j,size-j,"%s",(a && *a->model) ? a->model : "-"); break;
+        case 'S': j+=snprintf(out+j,size-j,"%s",(a && *a->serial) ? a->serial : "-"); break;
+        default:  out[j++]=*cp; break;
+        }
+    }
+    if(j>size-1)
+        j=size-1;
+    out[j]='\0';
+    return out;
+}
+
+/*-------------------------------------------------------------------------*/
+void sysattr_free(void)
+{
+    free(attrs);
+    attrs=NULL;
+    nattr=0;
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    sysattr.h
+   @author  Leslie Satenstein
+   @brief   Optional device attributes (size, rotational, model, serial)
+            in the annotation, driven by an output template.
+
+   With -t the annotation is built from a template instead of /dev/xxx:
+       -t '%d %s %r %m'     ->   #/dev/sdq3 3.6T HDD ST4000NM
+   Template codes
+       %d  device with its /dev/ prefix      %n  device name only
+       %s  size, 1024 based (3.6T)           %r  HDD or SSD
+       %m  model                             %S  serial
+       %%  a percent sign
+   sysattr_need() reduces the template to the set of attributes it uses.
+   sysattr_fetch() then reads only those, for every device in the
+   dictionary, in one pass. Each device's /sys/class/block/<dev> directory
+   is opened once and its attribute files are read with openat() relative
+   to it. Without -t nothing is fetched.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _SYSATTR_H_
+#define _SYSATTR_H_
+
+#include "dictionary.h"
+
+#define SA_SIZE     (1<<0)
+#define SA_ROTA     (1<<1)
+#define SA_MODEL    (1<<2)
+#define SA_SERIAL   (1<<3)
+
+/**
+ * @brief sysattr_need  Attributes referenced by a template
+ * @return              mask of SA_xxx bits, 0 if the template needs none
+ */
+unsigned sysattr_need(const char *tmpl);
+
+/**
+ * @brief sysattr_fetch Read the attributes in mask for every device name
+ *                      found among the values of the dictionary
+ * @param d             the dictionary
+ * @param mask          SA_xxx bits, from sysattr_need()
+ * @return              number of devices fetched
+ */
+int sysattr_fetch(const dictionary *d, unsigned mask);
+
+/**
+ * @brief sysattr_format Expand the template for device dev
+ * @param tmpl           the -t template
+ * @param prefix         printed by %d in front of dev ("/dev/")
+ * @param dev            device name
+ * @param out            result
+ * @param size           size of out
+ * @return               out
+ */
+char *sysattr_format(const char *tmpl, const char *prefix, const char *dev, char *out, size_t size);
+
+/**
+ * @brief sysattr_free  Release the fetched attributes
+ */
+void sysattr_free(void);
+
+#endif
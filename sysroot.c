@@ -0,0 +1,347 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    sysroot.c
+   @author  Leslie Satenstein
+   @brief   Alternate root path resolution (see sysroot.h)
+
+   openat2() has no glibc wrapper on older systems and is called through
+   syscall(). Kernels before 5.6 return ENOSYS; the path is then opened
+   with openat() relative to the root, which is right for ordinary trees
+   but does not confine absolute symlinks.
+
+   During a replay each function first asks replay_find() (capture.c):
+   a file is opened with fmemopen() on the mapped bytes, a directory is
+   listed with replay_readdir(), and only a descriptor for pread() is a
+   memfd, from replay_fd().
+*/
+/*--------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE             /* O_PATH, statx() */
+#include "sysroot.h"
+#include "capture.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+
+struct _sysdir_
+{
+    DIR          *dir;                  /* live                            */
+    long          cursor;               /* replay_readdir() position       */
+    struct dirent de;
+    char          path[PATH_MAX];       /* replay, links resolved          */
+};
+
+static int  rootfd=-1;
+static int  noopenat2;          /* kernel without openat2() */
+static char rootdir[PATH_MAX];
+
+/*-------------------------------------------------------------------------*/
+int sysroot_set(const char *root)
+{
+    sysroot_close();
+    if(root==NULL || *root=='\0' || !strcmp(root,"/"))
+        return 0;
+    rootfd=open(root,O_PATH|O_DIRECTORY|O_CLOEXEC);
+    if(rootfd<0)
+        return -1;
+    snprintf(rootdir,sizeof(rootdir),"%s",root);
+    debug("root %s fd %d\n",rootdir,rootfd);
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+const char *sysroot_dir(void)
+{
+    return rootdir;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief sysroot_open  openat2(rootfd,path,RESOLVE_IN_ROOT)
+ */
+/*--------------------------------------------------------------------------*/
+int sysroot_open(const char *path, int flags)
+{
+    struct open_how how;
+    struct replayent e;
+    int fd;
+
+    if(replay_active())
+        return replay_find(path,1,&e) ? -1 : replay_fd(&e);
+    if(rootfd<0)
+        return open(path,flags|O_CLOEXEC);
+    if(!noopenat2)
+    {
+        memset(&how,0,sizeof(how));
+        how.flags=flags|O_CLOEXEC;
+        how.resolve=RESOLVE_IN_ROOT|RESOLVE_NO_MAGICLINKS;
+        fd=syscall(SYS_openat2,rootfd,path,&how,sizeof(how));
+        if(fd>=0 || errno!=ENOSYS)
+            return fd;
+        noopenat2=1;
+        debug("openat2() not available, symlinks are not confined to %s\n",rootdir);
+    }
+    while(*path=='/')
+        path++;
+    return openat(rootfd,*path ? path : ".",flags|O_CLOEXEC);
+}
+
+/*-------------------------------------------------------------------------*/
+FILE *sysroot_fopen(const char *path)
+{
+    struct replayent e;
+    FILE *f;
+    int fd;
+
+    if(replay_active())
+    {
+        if(replay_find(path,1,&e))
+            return NULL;
+        if(e.type==CAP_FILE)            /* read in place, never written */
+            return fmemopen((void *)e.data,e.len,"r");
+    }
+    fd=sysroot_open(path,O_RDONLY);
+    if(fd<0)
+        return NULL;
+    f=fdopen(fd,"rb");
+    if(f==NULL)
+        close(fd);
+    return f;
+}
+
+/*-------------------------------------------------------------------------*/
+sysdir *sysroot_opendir(const char *path)
+{
+    struct replayent e;
+    sysdir *d;
+    int fd;
+
+    d=calloc(1,sizeof(sysdir));
+    if(d==NULL)
+        return NULL;
+    d->cursor=-1;
+    if(replay_active())
+    {
+        if(replay_find(path,1,&e)==0)
+        {
+            if(e.type==CAP_DIR)
+            {
+                strcpy(d->path,e.path);
+                return d;
+            }
+            errno=ENOTDIR;
+        }
+        free(d);
+        return NULL;
+    }
+    fd=sysroot_open(path,O_RDONLY|O_DIRECTORY);
+    if(fd>=0 && (d->dir=fdopendir(fd))==NULL)
+        close(fd);
+    if(d->dir==NULL)
+    {
+        free(d);
+        return NULL;
+    }
+    return d;
+}
+
+/*-------------------------------------------------------------------------*/
+struct dirent *sysroot_readdir(sysdir *d)
+{
+    if(d->dir!=NULL)
+        return readdir(d->dir);
+    return replay_readdir(d->path,&d->cursor,&d->de) ? &d->de : NULL;
+}
+
+/*-------------------------------------------------------------------------*/
+void sysroot_rewinddir(sysdir *d)
+{
+    if(d->dir!=NULL)
+        rewinddir(d->dir);
+    d->cursor=-1;
+}
+
+/*-------------------------------------------------------------------------*/
+void sysroot_closedir(sysdir *d)
+{
+    if(d==NULL)
+        return;
+    if(d->dir!=NULL)
+        closedir(d->dir);
+    free(d);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief sysroot_readat  openat() on the directory descriptor, or the
+ *                        bytes of the archive entry dir/rel
+ */
+/*--------------------------------------------------------------------------*/
+int sysroot_readat(sysdir *d, const char *rel, char *buf, size_t size)
+{
+    char path[2*PATH_MAX];
+    struct replayent e;
+    ssize_t len;
+    int fd;
+
+    if(d->dir!=NULL)
+    {
+        fd=openat(dirfd(d->dir),rel,O_RDONLY|O_CLOEXEC);
+        if(fd<0)
+            return -1;
+        len=read(fd,buf,size);
+        close(fd);
+        return len;
+    }
+    snprintf(path,sizeof(path),"%s/%s",d->path,rel);
+    if(replay_find(path,1,&e))
+        return -1;
+    if(e.type!=CAP_FILE)
+    {
+        errno= e.type==CAP_DIR ? EISDIR : EINVAL;
+        return -1;
+    }
+    len= e.len<size ? e.len : size;
+    memcpy(buf,e.data,len);
+    return len;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief sysroot_statx  Under --root the path is opened in the root first,
+ *                       so it costs an extra open; a replay answers with
+ *                       what capture_write() recorded
+ */
+/*--------------------------------------------------------------------------*/
+int sysroot_statx(const char *path, struct statx *stx)
+{
+    struct replayent e;
+    int fd;
+    int rc;
+
+    if(replay_active())
+    {
+        if(replay_find(path,1,&e))
+            return -1;
+        memset(stx,0,sizeof(*stx));
+        stx->stx_mask=STATX_TYPE|STATX_MODE|STATX_SIZE;
+        stx->stx_mode=e.mode;
+        stx->stx_size=e.size;
+        stx->stx_dev_major=major(e.dev);
+        stx->stx_dev_minor=minor(e.dev);
+        stx->stx_rdev_major=major(e.rdev);
+        stx->stx_rdev_minor=minor(e.rdev);
+        return 0;
+    }
+    if(rootfd<0)
+        return statx(AT_FDCWD,path,AT_STATX_DONT_SYNC,STATX_TYPE,stx);
+    fd=sysroot_open(path,O_PATH);
+    if(fd<0)
+        return -1;
+    rc=statx(fd,"",AT_EMPTY_PATH|AT_STATX_DONT_SYNC,STATX_TYPE,stx);
+    close(fd);
+    return rc;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief sysroot_readlink  The directory is resolved in the root, the link
+ *                          itself is read, not followed
+ */
+/*--------------------------------------------------------------------------*/
+int sysroot_readlink(const char *path, char *buf, size_t size)
+{
+    char dir[PATH_MAX];
+    struct replayent e;
+    const char *name;
+    ssize_t len;
+    int fd;
+
+    name=strrchr(path,'/');
+    if(name==NULL || size==0)
+        return -1;
+    if(replay_active())
+    {
+        if(replay_find(path,0,&e))
+            return -1;
+        if(e.type!=CAP_LINK)
+        {
+            errno=EINVAL;
+            return -1;
+        }
+        len= e.len<size ? e.len : size-1;
+        memcpy(buf,e.data,len);
+        buf[len]='\0';
+        return len;
+    }
+    snprintf(dir,sizeof(dir),"%.*s",(int)(name-path),path);
+    fd=sysroot_open(*dir ? dir : "/",O_PATH|O_DIRECTORY);
+    if(fd<0)
+        return -1;
+    len=readlinkat(fd,name+1,buf,size-1);
+    close(fd);
+    if(len<0)
+        return -1;
+    buf[len]='\0';
+    return len;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief sysroot_links  Each link of dir, read with readlinkat(), or from
+ *                       the archive
+ */
+/*--------------------------------------------------------------------------*/
+int sysroot_links(const char *dir, int (*fn)(const char *name, const char *target, void *arg), void *arg)
+{
+    sysdir *d;
+    struct dirent *de;
+    struct replayent e;
+    char target[PATH_MAX];
+    char path[2*PATH_MAX];
+    ssize_t len;
+    int n=0;
+
+    d=sysroot_opendir(dir);
+    if(d==NULL)
+        return -1;
+    while((de=sysroot_readdir(d))!=NULL)
+    {
+        if(*de->d_name=='.' || (de->d_type!=DT_LNK && de->d_type!=DT_UNKNOWN))
+            continue;
+        if(d->dir!=NULL)
+            len=readlinkat(dirfd(d->dir),de->d_name,target,sizeof(target)-1);
+        else
+        {
+            snprintf(path,sizeof(path),"%s/%s",d->path,de->d_name);
+            len= replay_find(path,0,&e) || e.type!=CAP_LINK || e.len>=sizeof(target)
+                 ? -1 : (ssize_t)e.len;
+            if(len>0)
+                memcpy(target,e.data,len);
+        }
+        if(len<=0)
+            continue;
+        target[len]='\0';
+        if(fn(de->d_name,target,arg))
+            break;
+        n++;
+    }
+    sysroot_closedir(d);
+    return n;
+}
+
+/*-------------------------------------------------------------------------*/
+void sysroot_close(void)
+{
+    if(rootfd>=0)
+        close(rootfd);
+    rootfd=-1;
+    *rootdir='\0';
+}
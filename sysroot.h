@@ -0,0 +1,114 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    sysroot.h
+   @author  Leslie Satenstein
+   @brief   Alternate root directory (--root) for every path the programs
+            read: the fstab, /dev/disk, /dev, /sys, /proc and /run/udev.
+
+   sysroot_set() opens the root directory once. Every later open is an
+   openat2() relative to that descriptor with RESOLVE_IN_ROOT, so absolute
+   symlinks and ".." inside a container root or a captured tree resolve
+   against that tree and never escape it. One process can walk many roots
+   without chroot or exec.
+
+   Without --root the functions open the path as given, as before.
+
+   After replay_open() (capture.h) the same functions answer from the
+   capture archive instead, for the paths it recorded, which is why
+   directories are read through sysdir and sysroot_readat() rather than
+   DIR and openat(), and why loopdev.c takes device numbers from
+   sysroot_statx().
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _SYSROOT_H_
+#define _SYSROOT_H_
+
+#include "dictionary.h"
+#include <dirent.h>
+
+struct statx;
+
+/** A directory of the root or of the replayed archive */
+typedef struct _sysdir_ sysdir;
+
+/**
+ * @brief sysroot_set  Resolve later paths under root
+ * @param root         directory, NULL or "" for the real root
+ * @return             0 if Ok, -1 if root can not be opened
+ */
+int sysroot_set(const char *root);
+
+/**
+ * @brief sysroot_dir  The root given to sysroot_set(), "" when none
+ */
+const char *sysroot_dir(void);
+
+/**
+ * @brief sysroot_open  open() a path under the root
+ * @return              file descriptor, -1 with errno set
+ */
+int sysroot_open(const char *path, int flags);
+
+/**
+ * @brief sysroot_fopen  fopen() for reading a path under the root
+ */
+FILE *sysroot_fopen(const char *path);
+
+/**
+ * @brief sysroot_opendir  opendir() of a path under the root
+ */
+sysdir *sysroot_opendir(const char *path);
+
+/**
+ * @brief sysroot_readdir  readdir(), "." and ".." may or may not be given
+ */
+struct dirent *sysroot_readdir(sysdir *dir);
+
+/**
+ * @brief sysroot_rewinddir  rewinddir()
+ */
+void sysroot_rewinddir(sysdir *dir);
+
+/**
+ * @brief sysroot_closedir  closedir()
+ */
+void sysroot_closedir(sysdir *dir);
+
+/**
+ * @brief sysroot_readat  Read at most size bytes of the file at the path
+ *                        rel, relative to dir; ../ reaches its parent
+ * @return                bytes read, -1 with errno set
+ */
+int sysroot_readat(sysdir *dir, const char *rel, char *buf, size_t size);
+
+/**
+ * @brief sysroot_statx  statx() of a path under the root, the last link
+ *                       followed, without syncing with remote filesystems
+ * @return               0 if Ok, -1 with errno set
+ */
+int sysroot_statx(const char *path, struct statx *stx);
+
+/**
+ * @brief sysroot_readlink  readlink() of a path under the root
+ * @return                  length of the target, -1 with errno set
+ */
+int sysroot_readlink(const char *path, char *buf, size_t size);
+
+/**
+ * @brief sysroot_links  Call fn(name,target,arg) for each symbolic link of
+ *                       a directory such as /dev/disk/by-uuid
+ * @return               number of links, -1 if dir can not be read
+ */
+int sysroot_links(const char *dir, int (*fn)(const char *name, const char *target, void *arg), void *arg);
+
+/**
+ * @brief sysroot_close  Back to the real root
+ */
+void sysroot_close(void);
+
+#endif
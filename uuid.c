@@ -0,0 +1,230 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    uuid.c
+   @author  Leslie Satenstein
+   @brief   UUID layouts and canonical form (see uuid.h)
+
+   The vector kernel takes the 36 characters of a UUID_DCE as three
+   loads (0-15, 16-31, 20-35), checks the four dashes with one compare,
+   gathers the 32 digits into two registers with pshufb, checks and
+   converts them with compares and masks, and joins digit pairs to
+   bytes with pmaddubsw. The canonical text of a valid UUID_DCE is the
+   input with bit 0x20 set: it turns A-F into a-f and leaves the digits
+   and the dashes as they are. The function is compiled for SSSE3 with
+   a target attribute, so the rest of the program keeps the default
+   instruction set.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "uuid.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UUID_X86
+#include <immintrin.h>
+#endif
+
+static int vector=-1;                   /* -1 not asked yet */
+
+/*--------------------------------------------------------------------------*/
+/* 0-15 for a hex digit, -1 else                                           */
+static int unhex(int c)
+{
+    if(c>='0' && c<='9')
+        return c-'0';
+    c|=0x20;
+    if(c>='a' && c<='f')
+        return c-'a'+10;
+    return -1;
+}
+
+/* n digits to n/2 bytes, -1 if one is not a digit                         */
+static int hex_bytes(const char *s, int n, unsigned char *bin)
+{
+    int i,hi,lo;
+
+    for(i=0;i<n;i+=2)
+    {
+        hi=unhex(s[i]);
+        lo=unhex(s[i+1]);
+        if(hi<0 || lo<0)
+            return -1;
+        *bin++=hi<<4 | lo;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/* UUID_DCE, one byte at a time                                            */
+static int dce_scalar(const char *s, unsigned char *bin)
+{
+    if(s[8]!='-' || s[13]!='-' || s[18]!='-' || s[23]!='-')
+        return -1;
+    if(hex_bytes(s,8,bin) || hex_bytes(s+9,4,bin+4) || hex_bytes(s+14,4,bin+6)
+       || hex_bytes(s+19,4,bin+8) || hex_bytes(s+24,12,bin+10))
+        return -1;
+    return 0;
+}
+
+#ifdef UUID_X86
+/*--------------------------------------------------------------------------*/
+/* 16 digits to 8 bytes, -1 if one is not a digit                          */
+__attribute__((target("ssse3")))
+static int unhex16(__m128i c, unsigned char *bin)
+{
+    __m128i lc,dig,let,v;
+
+    lc=_mm_or_si128(c,_mm_set1_epi8(0x20));
+    dig=_mm_and_si128(_mm_cmpgt_epi8(c,_mm_set1_epi8('0'-1)),_mm_cmplt_epi8(c,_mm_set1_epi8('9'+1)));
+    let=_mm_and_si128(_mm_cmpgt_epi8(lc,_mm_set1_epi8('a'-1)),_mm_cmplt_epi8(lc,_mm_set1_epi8('f'+1)));
+    if(_mm_movemask_epi8(_mm_or_si128(dig,let))!=0xFFFF)
+        return -1;
+    v=_mm_or_si128(_mm_and_si128(dig,_mm_sub_epi8(c,_mm_set1_epi8('0'))),
+                   _mm_andnot_si128(dig,_mm_sub_epi8(lc,_mm_set1_epi8('a'-10))));
+    v=_mm_maddubs_epi16(v,_mm_set1_epi16(0x0110));  /* 16*even + odd */
+    _mm_storel_epi64((__m128i *)bin,_mm_packus_epi16(v,v));
+    return 0;
+}
+
+/* UUID_DCE, 16 bytes at a time; s has 36 readable bytes                   */
+__attribute__((target("ssse3")))
+static int dce_ssse3(const char *s, unsigned char *bin)
+{
+    __m128i a,b,c,lo,hi,dash;
+
+    a=_mm_loadu_si128((const __m128i *)s);
+    b=_mm_loadu_si128((const __m128i *)(s+16));
+    c=_mm_loadu_si128((const __m128i *)(s+20));
+    dash=_mm_set1_epi8('-');
+    if((_mm_movemask_epi8(_mm_cmpeq_epi8(a,dash)) & 0x2100)!=0x2100     /* 8, 13 */
+       || (_mm_movemask_epi8(_mm_cmpeq_epi8(b,dash)) & 0x0084)!=0x0084) /* 18, 23 */
+        return -1;
+    lo=_mm_or_si128(_mm_shuffle_epi8(a,_mm_setr_epi8(0,1,2,3,4,5,6,7,9,10,11,12,14,15,-1,-1)),
+                    _mm_shuffle_epi8(b,_mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,0,1)));
+    hi=_mm_or_si128(_mm_shuffle_epi8(b,_mm_setr_epi8(3,4,5,6,8,9,10,11,12,13,14,15,-1,-1,-1,-1)),
+                    _mm_shuffle_epi8(c,_mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,12,13,14,15)));
+    if(unhex16(lo,bin) || unhex16(hi,bin+8))
+        return -1;
+    return 0;
+}
+
+/* the canonical text of a valid UUID_DCE                                  */
+__attribute__((target("ssse3")))
+static void dce_lower(const char *s, char *out)
+{
+    __m128i bit=_mm_set1_epi8(0x20);
+
+    _mm_storeu_si128((__m128i *)out,_mm_or_si128(_mm_loadu_si128((const __m128i *)s),bit));
+    _mm_storeu_si128((__m128i *)(out+16),_mm_or_si128(_mm_loadu_si128((const __m128i *)(s+16)),bit));
+    _mm_storeu_si128((__m128i *)(out+20),_mm_or_si128(_mm_loadu_si128((const __m128i *)(s+20)),bit));
+    out[UUID_STRLEN]='\0';
+}
+#endif
+
+/*--------------------------------------------------------------------------*/
+static int use_vector(void)
+{
+    if(vector<0)
+    {
+#ifdef UUID_X86
+        __builtin_cpu_init();
+        vector=__builtin_cpu_supports("ssse3")!=0;
+#else
+        vector=0;
+#endif
+        debug("uuid: %s kernel\n",vector ? "ssse3" : "scalar");
+    }
+    return vector;
+}
+
+/*-------------------------------------------------------------------------*/
+int uuid_scalar(int on)
+{
+    int was=use_vector();
+
+    if(on)
+        vector=0;
+    else
+        vector=-1;
+    return was;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief uuid_parse  By length, then the layout of that length
+ */
+/*--------------------------------------------------------------------------*/
+int uuid_parse(const char *s, unsigned char *bin)
+{
+    switch(strnlen(s,UUID_STRLEN+1))
+    {
+    case 36:
+#ifdef UUID_X86
+        if(use_vector())
+            return dce_ssse3(s,bin) ? UUID_NONE : UUID_DCE;
+#endif
+        return dce_scalar(s,bin) ? UUID_NONE : UUID_DCE;
+    case 32:
+        return hex_bytes(s,32,bin) ? UUID_NONE : UUID_HEX;
+    case 16:
+        return hex_bytes(s,16,bin) ? UUID_NONE : UUID_NTFS;
+    case 9:
+        if(s[4]!='-' || hex_bytes(s,4,bin) || hex_bytes(s+5,4,bin+2))
+            return UUID_NONE;
+        return UUID_VFAT;
+    case 11:
+        if(s[8]!='-' || hex_bytes(s,8,bin) || hex_bytes(s+9,2,bin+4))
+            return UUID_NONE;
+        return UUID_MBR;
+    default:
+        return UUID_NONE;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+ * @brief uuid_canon  Lower case; the dashes put back into UUID_HEX
+ */
+/*--------------------------------------------------------------------------*/
+int uuid_canon(const char *s, char *out)
+{
+    static const char xd[]="0123456789abcdef";
+    unsigned char bin[16];
+    int form;
+    int i,j;
+
+    form=uuid_parse(s,bin);
+    switch(form)
+    {
+    case UUID_NONE:
+        return UUID_NONE;
+    case UUID_DCE:
+#ifdef UUID_X86
+        if(use_vector())
+        {
+            dce_lower(s,out);
+            return form;
+        }
+#endif
+        /* FALLTHROUGH */
+    case UUID_NTFS:
+    case UUID_VFAT:
+    case UUID_MBR:
+        for(i=0;s[i];i++)
+            out[i]=s[i]|0x20;           /* digits and - have it already */
+        out[i]='\0';
+        return form;
+    default:                            /* UUID_HEX */
+        for(i=j=0;i<16;i++)
+        {
+            if(i==4 || i==6 || i==8 || i==10)
+                out[j++]='-';
+            out[j++]=xd[bin[i]>>4];
+            out[j++]=xd[bin[i]&15];
+        }
+        out[j]='\0';
+        return form;
+    }
+}
@@ -0,0 +1,60 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+
+/*-------------------------------------------------------------------------*/
+/**
+   @file    uuid.h
+   @author  Leslie Satenstein
+   @brief   Validate, decode and canonicalize filesystem UUIDs.
+
+   The same UUID is written differently by different sources: udev
+   names vfat and ntfs serials in upper case (5FBD-7164, 5FBD7164754805FF),
+   an fstab may have them in lower case, and a UUID= without dashes is
+   accepted by mount. Keys are stored and looked up in one canonical
+   form, lower case, 8-4-4-4-12 for the 16 byte UUIDs:
+       UUID_DCE     2b2e8ae3-6339-4df1-8f06-e91a16f3e424
+       UUID_HEX     2B2E8AE363394DF18F06E91A16F3E424     -> dashed
+       UUID_NTFS    5FBD7164754805FF
+       UUID_VFAT    5FBD-7164
+       UUID_MBR     0a1b2c3d-01                           MBR PARTUUID
+   Text of any other shape (a label, a path) is not a UUID and is left
+   alone. On x86 with SSSE3 the 36 character form is checked and
+   decoded 16 bytes at a time with byte shuffles, else one byte at a
+   time; the CPU is asked once.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _UUID_H_
+#define _UUID_H_
+
+#include "dictionary.h"
+
+#define UUID_STRLEN 36          /* the canonical text, without the NUL */
+
+enum uuid_form { UUID_NONE, UUID_DCE, UUID_HEX, UUID_NTFS, UUID_VFAT, UUID_MBR };
+
+/**
+ * @brief uuid_parse  Check the layout and decode the hex digits
+ * @param s           the text
+ * @param bin         16 bytes, the value, 4 to 16 of them used
+ * @return            enum uuid_form, UUID_NONE if s is not a UUID
+ */
+int uuid_parse(const char *s, unsigned char *bin);
+
+/**
+ * @brief uuid_canon  The canonical text of a UUID
+ * @param s           the text
+ * @param out         UUID_STRLEN+1 bytes, untouched if s is not a UUID
+ * @return            enum uuid_form, UUID_NONE if s is not a UUID
+ */
+int uuid_canon(const char *s, char *out);
+
+/**
+ * @brief uuid_scalar  Use the byte at a time code even if the CPU has
+ *                     SSSE3 (uuidbench)
+ * @return             1 if the vector code was in use before
+ */
+int uuid_scalar(int on);
+
+#endif
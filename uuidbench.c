@@ -0,0 +1,127 @@
+/* Copyright (c) 2016 by Leslie Satenstein <lsatenstein@yahoo.com>
+ * MIT License  (refer to dictionary.h for the full license text)
+ */
+/*-------------------------------------------------------------------------*/
+/**
+   @file    uuidbench.c
+   @author  Leslie Satenstein
+   @brief   Throughput of uuid_canon() and uuid_parse(), in UUIDs/sec.
+
+   uuidbench [count [rounds]]
+
+   Builds count random UUIDs, mostly 8-4-4-4-12 in mixed case with some
+   vfat, ntfs and undashed ones and a few labels, then times both
+   functions with the vector kernel and with the scalar code. The two
+   must give the same text; a difference is reported and exits 1.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include "uuid.h"
+#include <time.h>
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+/*--------------------------------------------------------------------------*/
+static void make(char *s, unsigned r)
+{
+    static const char up[]="0123456789ABCDEF";
+    static const char lo[]="0123456789abcdef";
+    const char *xd= r&1 ? up : lo;
+    int i;
+
+    switch(r>>1 & 15)
+    {
+    case 0:
+        sprintf(s,"%c%c%c%c-%c%c%c%c",up[r>>8&15],up[r>>12&15],up[r>>16&15],up[r>>20&15],
+                up[r>>24&15],up[r>>28&15],up[r>>5&15],up[r>>9&15]);
+        return;
+    case 1:
+        for(i=0;i<16;i++)
+            s[i]=up[(r>>i|r<<(32-i))&15];
+        s[16]='\0';
+        return;
+    case 2:
+        for(i=0;i<32;i++)
+            s[i]=xd[rand()&15];
+        s[32]='\0';
+        return;
+    case 3:
+        sprintf(s,"home%u",r);
+        return;
+    default:
+        for(i=0;i<36;i++)
+            s[i]= (i==8 || i==13 || i==18 || i==23) ? '-' : xd[rand()&15];
+        s[36]='\0';
+        return;
+    }
+}
+
+static double run(char (*in)[40], char (*out)[40], long n, int rounds, int parse)
+{
+    unsigned char bin[16];
+    double t;
+    long i,ok=0;
+    int r;
+
+    t=now();
+    for(r=0;r<rounds;r++)
+        for(i=0;i<n;i++)
+            ok+= parse ? uuid_parse(in[i],bin)!=UUID_NONE : uuid_canon(in[i],out[i])!=UUID_NONE;
+    t=now()-t;
+    if(ok==0)
+        fprintf(stderr,"no UUID\n");
+    return (double)n*rounds/t;
+}
+
+/*--------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    char (*in)[40],(*vout)[40],(*sout)[40];
+    long n=1<<20;
+    int  rounds=10;
+    long i;
+    int  vec;
+
+    if(argc>1)
+        n=atol(argv[1]);
+    if(argc>2)
+        rounds=atoi(argv[2]);
+    in=calloc(n,40);
+    vout=calloc(n,40);
+    sout=calloc(n,40);
+    if(n<=0 || rounds<=0 || in==NULL || vout==NULL || sout==NULL)
+    {
+        fprintf(stderr,"usage: uuidbench [count [rounds]]\n");
+        exit(2);
+    }
+    srand(1);
+    for(i=0;i<n;i++)
+        make(in[i],(unsigned)rand()*2654435761u);
+
+    vec=uuid_scalar(0);
+    if(vec)
+    {
+        printf("ssse3  canon %12.0f UUIDs/sec\n",run(in,vout,n,rounds,0));
+        printf("ssse3  parse %12.0f UUIDs/sec\n",run(in,vout,n,rounds,1));
+    }
+    uuid_scalar(1);
+    printf("scalar canon %12.0f UUIDs/sec\n",run(in,sout,n,rounds,0));
+    printf("scalar parse %12.0f UUIDs/sec\n",run(in,sout,n,rounds,1));
+    if(vec)
+        for(i=0;i<n;i++)
+            if(strcmp(vout[i],sout[i]))
+            {
+                fprintf(stderr,"%s: ssse3 %s, scalar %s\n",in[i],vout[i],sout[i]);
+                exit(1);
+            }
+    free(in);
+    free(vout);
+    free(sout);
+    return 0;
+}